@@ -46,9 +46,48 @@
 	 (((ADDR) & MGR_SELECT_MASK) == (BASE_MMR))      ? (APB_BASE_MMR)      | ((ADDR) & 0xfff) : \
 	 -1)
 
+// Count the register accesses of each calibration stage in cal_profile
+#ifndef ENABLE_CAL_PROFILE
+#define ENABLE_CAL_PROFILE 0
+#endif
+
+// Leave out the SCC manager writes that would change nothing; see
+// scc_shadow_write
+#ifndef ENABLE_SCC_SHADOW
+#define ENABLE_SCC_SHADOW 0
+#endif
+
+#if ENABLE_CAL_PROFILE
+void cal_profile_io(alt_u32 addr, alt_u32 write);
+
+#define __IOWR_32DIRECT(ADDR, DATA) \
+	(cal_profile_io(ADDR, 1), \
+	 write_register(HPS_SDR_BASE, __AVL_TO_APB(ADDR), DATA))
+
+#define __IORD_32DIRECT(ADDR) \
+	(cal_profile_io(ADDR, 0), \
+	 read_register(HPS_SDR_BASE, __AVL_TO_APB(ADDR)))
+#else
+#define __IOWR_32DIRECT(ADDR, DATA) \
+	write_register(HPS_SDR_BASE, __AVL_TO_APB(ADDR), DATA)
+
+#define __IORD_32DIRECT(ADDR) \
+	read_register(HPS_SDR_BASE, __AVL_TO_APB(ADDR))
+#endif
+
+#if ENABLE_SCC_SHADOW
+void scc_shadow_write(alt_u32 addr, alt_u32 data);
+alt_u32 scc_shadow_read(alt_u32 addr);
+
 #define IOWR_32DIRECT(BASE, OFFSET, DATA) \
-	write_register(HPS_SDR_BASE, __AVL_TO_APB((alt_u32)((BASE) + (OFFSET))), DATA)
+	scc_shadow_write((alt_u32)((BASE) + (OFFSET)), DATA)
 
 #define IORD_32DIRECT(BASE, OFFSET) \
-	read_register(HPS_SDR_BASE, __AVL_TO_APB((alt_u32)((BASE) + (OFFSET))))
+	scc_shadow_read((alt_u32)((BASE) + (OFFSET)))
+#else
+#define IOWR_32DIRECT(BASE, OFFSET, DATA) \
+	__IOWR_32DIRECT((alt_u32)((BASE) + (OFFSET)), DATA)
 
+#define IORD_32DIRECT(BASE, OFFSET) \
+	__IORD_32DIRECT((alt_u32)((BASE) + (OFFSET)))
+#endif
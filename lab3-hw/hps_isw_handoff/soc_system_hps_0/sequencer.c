@@ -610,6 +610,448 @@ static void set_failing_group_stage(alt_u32 group, alt_u32 stage, alt_u32 substa
 
 }
 
+#if ENABLE_CAL_PROFILE
+
+// Calibration profile
+//
+// Every register access, and every read or write test, is counted
+// against the stage and group last written to REG_FILE_CUR_STAGE, and
+// the time between changes of either is added to both.  Time comes from CAL_PROFILE_CYCLES(),
+// which sdram.h may define; by default it is the Cortex-A9 cycle
+// counter.  After calibration the profile is copied to
+// CAL_PROFILE_HANDOFF, if defined, for u-boot or Linux to read.
+
+cal_profile_t cal_profile;
+alt_u32 cal_profile_stage;
+alt_u32 cal_profile_group;
+alt_u32 cal_profile_last;
+alt_u32 cal_profile_retest;
+alt_u32 cal_profile_deskew;
+
+#ifndef CAL_PROFILE_CYCLES
+static inline void cal_profile_cycles_init(void)
+{
+#if defined(__arm__)
+	// Enable the cycle counter: PMCR.E, then PMCNTENSET.C
+	asm volatile ("mcr p15, 0, %0, c9, c12, 0" : : "r" (1));
+	asm volatile ("mcr p15, 0, %0, c9, c12, 1" : : "r" (0x80000000));
+#endif
+}
+
+static inline alt_u32 cal_profile_cycles(void)
+{
+	alt_u32 ccnt = 0;
+#if defined(__arm__)
+	asm volatile ("mrc p15, 0, %0, c9, c13, 0" : "=r" (ccnt));
+#endif
+	return ccnt;
+}
+#define CAL_PROFILE_CYCLES_INIT()	cal_profile_cycles_init()
+#define CAL_PROFILE_CYCLES()		cal_profile_cycles()
+#endif
+
+#ifndef CAL_PROFILE_CYCLES_INIT
+#define CAL_PROFILE_CYCLES_INIT()
+#endif
+
+void cal_profile_io(alt_u32 addr, alt_u32 write)
+{
+	alt_u32 mgr;
+	cal_profile_count_t *stage = &cal_profile.stage[cal_profile_stage];
+	cal_profile_count_t *group = &cal_profile.group[cal_profile_stage][cal_profile_group];
+
+	switch (addr & MGR_SELECT_MASK) {
+	case BASE_SCC_MGR:	mgr = CAL_PROFILE_SCC; break;
+	case BASE_RW_MGR:	mgr = CAL_PROFILE_RW; break;
+	case BASE_PHY_MGR:	mgr = CAL_PROFILE_PHY; break;
+	case BASE_REG_FILE:	mgr = CAL_PROFILE_REG_FILE; break;
+	default:		mgr = CAL_PROFILE_OTHER; break;
+	}
+
+	if (write) {
+		stage->writes[mgr]++;
+		group->writes[mgr]++;
+	} else {
+		stage->reads[mgr]++;
+		group->reads[mgr]++;
+	}
+}
+
+static void cal_profile_test(void)
+{
+	cal_profile_count_t *stage = &cal_profile.stage[cal_profile_stage];
+	cal_profile_count_t *group = &cal_profile.group[cal_profile_stage][cal_profile_group];
+
+	stage->tests++;
+	group->tests++;
+	if (cal_profile_retest) {
+		stage->retests++;
+		group->retests++;
+	}
+	if (cal_profile_deskew) {
+		stage->deskew++;
+		group->deskew++;
+	}
+}
+
+#if ENABLE_SCC_SHADOW
+static void cal_profile_saved(void)
+{
+	cal_profile.stage[cal_profile_stage].saved++;
+	cal_profile.group[cal_profile_stage][cal_profile_group].saved++;
+}
+#endif
+
+static void cal_profile_switch(alt_u32 stage, alt_u32 group)
+{
+	alt_u32 now = CAL_PROFILE_CYCLES();
+
+	cal_profile.stage[cal_profile_stage].cycles += now - cal_profile_last;
+	cal_profile.group[cal_profile_stage][cal_profile_group].cycles += now - cal_profile_last;
+	cal_profile_last = now;
+
+	cal_profile_stage = (stage < CAL_PROFILE_STAGES) ? stage : CAL_STAGE_NIL;
+	cal_profile_group = (group < MAX_DQS) ? group : 0;
+}
+
+static void cal_profile_start(void)
+{
+	alt_u32 *p = (alt_u32 *) &cal_profile;
+	alt_u32 i;
+
+	for (i = 0; i < sizeof (cal_profile) / sizeof (alt_u32); i++) {
+		p[i] = 0;
+	}
+	cal_profile.magic = CAL_PROFILE_MAGIC;
+	cal_profile.size = sizeof (cal_profile);
+
+	CAL_PROFILE_CYCLES_INIT();
+	cal_profile_stage = CAL_STAGE_NIL;
+	cal_profile_group = 0;
+	cal_profile_last = CAL_PROFILE_CYCLES();
+}
+
+static void cal_profile_finish(alt_u32 pass)
+{
+	cal_profile_count_t *t = &cal_profile.total;
+	alt_u32 s, m;
+
+	cal_profile_switch(CAL_STAGE_NIL, 0);
+	cal_profile.pass = pass;
+
+	for (s = 0; s < CAL_PROFILE_STAGES; s++) {
+		t->cycles += cal_profile.stage[s].cycles;
+		t->tests += cal_profile.stage[s].tests;
+		t->retests += cal_profile.stage[s].retests;
+		t->deskew += cal_profile.stage[s].deskew;
+		t->saved += cal_profile.stage[s].saved;
+		for (m = 0; m < CAL_PROFILE_MGRS; m++) {
+			t->reads[m] += cal_profile.stage[s].reads[m];
+			t->writes[m] += cal_profile.stage[s].writes[m];
+		}
+	}
+
+#ifdef CAL_PROFILE_HANDOFF
+	// SDRAM is only usable if calibration passed
+	if (pass) {
+		alt_u32 *src = (alt_u32 *) &cal_profile;
+		volatile alt_u32 *dst = (volatile alt_u32 *) (CAL_PROFILE_HANDOFF);
+		alt_u32 i;
+
+		for (i = 0; i < sizeof (cal_profile) / sizeof (alt_u32); i++) {
+			dst[i] = src[i];
+		}
+	}
+#endif
+}
+
+#define CAL_PROFILE_SWITCH(stage, group)	cal_profile_switch(stage, group)
+#define CAL_PROFILE_TEST()			cal_profile_test()
+#define CAL_PROFILE_RETEST(on)			(cal_profile_retest = (on))
+#define CAL_PROFILE_DESKEW(on)			(cal_profile_deskew = (on))
+#define CAL_PROFILE_SAVED()			cal_profile_saved()
+#else
+#define CAL_PROFILE_SWITCH(stage, group)
+#define CAL_PROFILE_TEST()
+#define CAL_PROFILE_RETEST(on)
+#define CAL_PROFILE_DESKEW(on)
+#define CAL_PROFILE_SAVED()
+#endif
+
+#if ENABLE_SCC_SHADOW
+
+// SCC manager shadow
+//
+// While calibrating, every register access goes through scc_shadow_write
+// and scc_shadow_read, which keep a copy of the SCC manager's staging
+// registers and of which scan chains may not hold what is staged.  The
+// shadow leaves out a write that would not change a staging register, a
+// load of chains that already hold theirs, and a read of a staging
+// register it knows.  SCC_MGR_UPD waits until something other than the
+// SCC manager is written, so the loads of a group's chains, by one helper
+// or several, take one update; a chain loaded again first sends the
+// update, so the periphery still steps through every setting a chain took,
+// as scc_mgr_set_group_dqs_io_and_oct_out1_gradual needs.  Any other SCC
+// register written, and the group counter set to broadcast, make the
+// shadow forget what it knows.
+
+#define SCC_SHADOW_UNKNOWN		0xFFFFFFFF
+
+// SCC_MGR_DQS_IN_DELAY to SCC_MGR_OCT_OUT2_DELAY, indexed by group, and
+// SCC_MGR_IO_OUT1_DELAY to SCC_MGR_IO_IN_DELAY, by pin of the group counter's
+// group: DQ, DQS, then DM
+#define SCC_SHADOW_DQS_REGS		6
+#define SCC_SHADOW_IO_REGS		3
+#define SCC_SHADOW_IO_PINS		(RW_MGR_MEM_DQ_PER_WRITE_DQS + 1 + RW_MGR_NUM_DM_PER_WRITE_GROUP)
+
+#define SCC_SHADOW_ALL(n)		((n) >= 32 ? 0xFFFFFFFF : (1 << (n)) - 1)
+
+// Scan chains, a bit for each group or pin
+typedef struct scc_shadow_chains_type {
+	alt_u32 dqs;
+	alt_u32 dqs_io;
+	alt_u32 dq[RW_MGR_MEM_IF_WRITE_DQS_WIDTH];
+	alt_u32 dm[RW_MGR_MEM_IF_WRITE_DQS_WIDTH];
+} scc_shadow_chains_t;
+
+static struct {
+	alt_u32 on;
+	alt_u32 group;
+	alt_u32 dqs[SCC_SHADOW_DQS_REGS][RW_MGR_MEM_IF_READ_DQS_WIDTH];
+	alt_u32 io[SCC_SHADOW_IO_REGS][RW_MGR_MEM_IF_WRITE_DQS_WIDTH][SCC_SHADOW_IO_PINS];
+	// Chains that may not hold their staging registers, and chains
+	// loaded since the last SCC_MGR_UPD went out
+	scc_shadow_chains_t dirty;
+	scc_shadow_chains_t loaded;
+	alt_u32 loaded_any;
+	alt_u32 upd_pending;
+} scc_shadow;
+
+static void scc_shadow_flush(void)
+{
+	alt_u32 *p = (alt_u32 *) &scc_shadow.loaded;
+	alt_u32 i;
+
+	if (scc_shadow.upd_pending) {
+		__IOWR_32DIRECT(SCC_MGR_UPD, 0);
+		scc_shadow.upd_pending = 0;
+		for (i = 0; i < sizeof (scc_shadow.loaded) / sizeof (alt_u32); i++) {
+			p[i] = 0;
+		}
+		scc_shadow.loaded_any = 0;
+	}
+}
+
+static void scc_shadow_forget(void)
+{
+	alt_u32 *v = &scc_shadow.dqs[0][0];
+	alt_u32 *d = (alt_u32 *) &scc_shadow.dirty;
+	alt_u32 *l = (alt_u32 *) &scc_shadow.loaded;
+	alt_u32 i;
+
+	scc_shadow_flush();
+
+	scc_shadow.group = SCC_SHADOW_UNKNOWN;
+	for (i = 0; i < sizeof (scc_shadow.dqs) / sizeof (alt_u32); i++) {
+		v[i] = SCC_SHADOW_UNKNOWN;
+	}
+	v = &scc_shadow.io[0][0][0];
+	for (i = 0; i < sizeof (scc_shadow.io) / sizeof (alt_u32); i++) {
+		v[i] = SCC_SHADOW_UNKNOWN;
+	}
+	for (i = 0; i < sizeof (scc_shadow.dirty) / sizeof (alt_u32); i++) {
+		d[i] = 0xFFFFFFFF;
+		l[i] = 0xFFFFFFFF;
+	}
+	scc_shadow.loaded_any = 1;
+}
+
+// From the start of calibration to the end, nothing is known of the SCC
+// manager but what calibration does to it
+static void scc_shadow_start(void)
+{
+	scc_shadow.upd_pending = 0;
+	scc_shadow_forget();
+	scc_shadow.on = 1;
+}
+
+static void scc_shadow_finish(void)
+{
+	scc_shadow_flush();
+	scc_shadow.on = 0;
+}
+
+// The shadow of a staging register, and the chain and bit it loads into;
+// 0 if the shadow does not keep the register
+static alt_u32 *scc_shadow_reg(alt_u32 addr, alt_u32 **chain, alt_u32 *bit)
+{
+	alt_u32 reg = (addr - BASE_SCC_MGR) >> 8;
+	alt_u32 item = ((addr - BASE_SCC_MGR) & 0xFF) >> 2;
+	alt_u32 g = scc_shadow.group;
+
+	if ((addr & MGR_SELECT_MASK) != BASE_SCC_MGR) {
+		return 0;
+	}
+
+	if (addr >= SCC_MGR_DQS_IN_DELAY && addr < SCC_MGR_DQS_IN_DELAY + (SCC_SHADOW_DQS_REGS << 8) &&
+	    item < RW_MGR_MEM_IF_READ_DQS_WIDTH) {
+		*chain = &scc_shadow.dirty.dqs;
+		*bit = 1 << item;
+		return &scc_shadow.dqs[reg - ((SCC_MGR_DQS_IN_DELAY - BASE_SCC_MGR) >> 8)][item];
+	}
+
+	if (addr >= SCC_MGR_IO_OUT1_DELAY && addr < SCC_MGR_IO_OUT1_DELAY + (SCC_SHADOW_IO_REGS << 8) &&
+	    item < SCC_SHADOW_IO_PINS && g < RW_MGR_MEM_IF_WRITE_DQS_WIDTH) {
+		if (item < RW_MGR_MEM_DQ_PER_WRITE_DQS) {
+			*chain = &scc_shadow.dirty.dq[g];
+			*bit = 1 << item;
+		} else if (item == RW_MGR_MEM_DQ_PER_WRITE_DQS) {
+			*chain = &scc_shadow.dirty.dqs_io;
+			*bit = 1 << g;
+		} else {
+			*chain = &scc_shadow.dirty.dm[g];
+			*bit = 1 << (item - RW_MGR_MEM_DQ_PER_WRITE_DQS - 1);
+		}
+		return &scc_shadow.io[reg - ((SCC_MGR_IO_OUT1_DELAY - BASE_SCC_MGR) >> 8)][g][item];
+	}
+
+	return 0;
+}
+
+// Load the chains in items, unless none may differ from its staging
+// registers
+static void scc_shadow_load(alt_u32 *dirty, alt_u32 *loaded, alt_u32 items, alt_u32 addr, alt_u32 data)
+{
+	if ((*dirty & items) == 0) {
+		CAL_PROFILE_SAVED();
+		return;
+	}
+
+	if (*loaded & items) {
+		scc_shadow_flush();
+	}
+	__IOWR_32DIRECT(addr, data);
+	*dirty &= ~items;
+	*loaded |= items;
+	scc_shadow.loaded_any = 1;
+}
+
+void scc_shadow_write(alt_u32 addr, alt_u32 data)
+{
+	alt_u32 *reg;
+	alt_u32 *chain;
+	alt_u32 bit;
+	alt_u32 items = 0;
+	alt_u32 g = scc_shadow.group;
+
+	if (!scc_shadow.on) {
+		__IOWR_32DIRECT(addr, data);
+		return;
+	}
+
+	if ((addr & MGR_SELECT_MASK) != BASE_SCC_MGR) {
+		// The other managers act on the settings in effect; the
+		// register file only holds what calibration reports
+		if ((addr & MGR_SELECT_MASK) != BASE_REG_FILE) {
+			scc_shadow_flush();
+		}
+		__IOWR_32DIRECT(addr, data);
+		return;
+	}
+
+	reg = scc_shadow_reg(addr, &chain, &bit);
+	if (reg != 0) {
+		if (*reg == data) {
+			CAL_PROFILE_SAVED();
+		} else {
+			__IOWR_32DIRECT(addr, data);
+			*reg = data;
+			*chain |= bit;
+		}
+		return;
+	}
+
+	switch (addr) {
+	case SCC_MGR_GROUP_COUNTER:
+		if (data == g) {
+			CAL_PROFILE_SAVED();
+			return;
+		}
+		if (data < RW_MGR_MEM_IF_WRITE_DQS_WIDTH) {
+			__IOWR_32DIRECT(addr, data);
+			scc_shadow.group = data;
+			return;
+		}
+		break;
+	case SCC_MGR_DQS_ENA:
+		items = (data == 0xFF) ? SCC_SHADOW_ALL(RW_MGR_MEM_IF_READ_DQS_WIDTH) :
+			(data < RW_MGR_MEM_IF_READ_DQS_WIDTH) ? 1 << data : 0;
+		if (items) {
+			scc_shadow_load(&scc_shadow.dirty.dqs, &scc_shadow.loaded.dqs, items, addr, data);
+			return;
+		}
+		break;
+	case SCC_MGR_DQS_IO_ENA:
+		items = (data == 0xFF) ? SCC_SHADOW_ALL(RW_MGR_MEM_IF_WRITE_DQS_WIDTH) :
+			(g < RW_MGR_MEM_IF_WRITE_DQS_WIDTH) ? 1 << g : 0;
+		if (items) {
+			scc_shadow_load(&scc_shadow.dirty.dqs_io, &scc_shadow.loaded.dqs_io, items, addr, data);
+			return;
+		}
+		break;
+	case SCC_MGR_DQ_ENA:
+		if (g < RW_MGR_MEM_IF_WRITE_DQS_WIDTH) {
+			items = (data == 0xFF) ? SCC_SHADOW_ALL(RW_MGR_MEM_DQ_PER_WRITE_DQS) :
+				(data < RW_MGR_MEM_DQ_PER_WRITE_DQS) ? 1 << data : 0;
+		}
+		if (items) {
+			scc_shadow_load(&scc_shadow.dirty.dq[g], &scc_shadow.loaded.dq[g], items, addr, data);
+			return;
+		}
+		break;
+	case SCC_MGR_DM_ENA:
+		if (g < RW_MGR_MEM_IF_WRITE_DQS_WIDTH) {
+			items = (data == 0xFF) ? SCC_SHADOW_ALL(RW_MGR_NUM_DM_PER_WRITE_GROUP) :
+				(data < RW_MGR_NUM_DM_PER_WRITE_GROUP) ? 1 << data : 0;
+		}
+		if (items) {
+			scc_shadow_load(&scc_shadow.dirty.dm[g], &scc_shadow.loaded.dm[g], items, addr, data);
+			return;
+		}
+		break;
+	case SCC_MGR_UPD:
+		if (scc_shadow.upd_pending || !scc_shadow.loaded_any) {
+			CAL_PROFILE_SAVED();
+		} else {
+			scc_shadow.upd_pending = 1;
+		}
+		return;
+	}
+
+	scc_shadow_forget();
+	__IOWR_32DIRECT(addr, data);
+}
+
+alt_u32 scc_shadow_read(alt_u32 addr)
+{
+	alt_u32 *reg;
+	alt_u32 *chain;
+	alt_u32 bit;
+
+	if (!scc_shadow.on || (reg = scc_shadow_reg(addr, &chain, &bit)) == 0) {
+		return __IORD_32DIRECT(addr);
+	}
+
+	if (*reg == SCC_SHADOW_UNKNOWN) {
+		*reg = __IORD_32DIRECT(addr);
+	} else {
+		CAL_PROFILE_SAVED();
+	}
+	return *reg;
+}
+
+#endif
+
 static inline void reg_file_set_group(alt_u32 set_group)
 {
 	// Read the current group and stage
@@ -623,6 +1065,8 @@ static inline void reg_file_set_group(alt_u32 set_group)
 
 	// Write the data back
 	IOWR_32DIRECT (REG_FILE_CUR_STAGE, 0, cur_stage_group);
+
+	CAL_PROFILE_SWITCH(cur_stage_group & 0xFF, set_group);
 }
 
 static inline void reg_file_set_stage(alt_u32 set_stage)
@@ -638,6 +1082,8 @@ static inline void reg_file_set_stage(alt_u32 set_stage)
 
 	// Write the data back
 	IOWR_32DIRECT (REG_FILE_CUR_STAGE, 0, cur_stage_group);
+
+	CAL_PROFILE_SWITCH(set_stage & 0xFF, cur_stage_group >> 16);
 }
 
 static inline void reg_file_set_sub_stage(alt_u32 set_sub_stage)
@@ -3754,6 +4200,8 @@ alt_u32 rw_mgr_mem_calibrate_read_test (alt_u32 rank_bgn, alt_u32 group, alt_u32
 	t_btfld tmp_bit_chk;
 	alt_u32 rank_end = all_ranks ? RW_MGR_MEM_NUMBER_OF_RANKS : (rank_bgn + NUM_RANKS_PER_SHADOW_REG);
 
+	CAL_PROFILE_TEST();
+
 #if LRDIMM
 	// USER Disable MB Write-levelling mode and enter normal operation
 	rw_mgr_lrdimm_rc_program(0,12,0x0);
@@ -3781,7 +4229,7 @@ alt_u32 rw_mgr_mem_calibrate_read_test (alt_u32 rank_bgn, alt_u32 group, alt_u32
 		
 		if(quick_read_mode) {
 			IOWR_32DIRECT (RW_MGR_LOAD_CNTR_0, 0, 0x1); /* need at least two (1+1) reads to capture failures */
-		} else if (all_groups) {
+		} else if (all_groups == 1) {
 			IOWR_32DIRECT (RW_MGR_LOAD_CNTR_0, 0, 0x06);
 		} else {
 			IOWR_32DIRECT (RW_MGR_LOAD_CNTR_0, 0, 0x32);
@@ -3819,7 +4267,7 @@ alt_u32 rw_mgr_mem_calibrate_read_test (alt_u32 rank_bgn, alt_u32 group, alt_u32
 #endif
 	
 	#if DDRX
-	IOWR_32DIRECT (RW_MGR_RUN_SINGLE_GROUP, (group << 2), __RW_MGR_CLEAR_DQS_ENABLE);
+	IOWR_32DIRECT (all_groups ? RW_MGR_RUN_ALL_GROUPS : RW_MGR_RUN_SINGLE_GROUP, (group << 2), __RW_MGR_CLEAR_DQS_ENABLE);
 	#endif
 	
 	if (all_correct)
@@ -3855,6 +4303,39 @@ static inline alt_u32 rw_mgr_mem_calibrate_read_test_all_ranks (alt_u32 group, a
     return success;
 }
 
+#if ENABLE_ADAPTIVE_TRIES
+//USER A sweep that passes until it reaches an edge tests each setting with
+//USER READ_TEST_SWEEP_TRIES; this gives the last setting before the edge num_tries
+static alt_u32 rw_mgr_mem_calibrate_read_test_confirm (alt_u32 group, alt_u32 num_tries, alt_u32 all_correct, t_btfld *bit_chk, alt_u32 all_groups)
+{
+	alt_u32 success;
+
+	CAL_PROFILE_RETEST(1);
+	success = rw_mgr_mem_calibrate_read_test_all_ranks (group, num_tries, all_correct, bit_chk, all_groups);
+	CAL_PROFILE_RETEST(0);
+
+	return success;
+}
+#define READ_TEST_SWEEP_TRIES(num_tries)	1
+#else
+#define READ_TEST_SWEEP_TRIES(num_tries)	(num_tries)
+#endif
+
+#if ENABLE_CAL_HINTS
+// Calibration hints
+//
+// The DQS enable and LFIFO searches start where they found their edges
+// last time and record where they found them this time.  The hints only
+// decide where a search starts: it still confirms each edge with the
+// tests it always ran, moving on from there as far as it has to.
+
+#ifdef CAL_HINTS_DEFAULT
+cal_hints_t cal_hints = CAL_HINTS_DEFAULT;
+#else
+cal_hints_t cal_hints;
+#endif
+#endif
+
 #if ENABLE_DELAY_CHAIN_WRITE
 void rw_mgr_incr_vfifo_auto(alt_u32 grp) {
 	alt_u32 v;
@@ -3900,6 +4381,11 @@ void rw_mgr_incr_vfifo(alt_u32 grp, alt_u32 *v) {
 	(*v)++;
 #if USE_DQS_TRACKING && !HHP_HPS
 	IOWR_32DIRECT (TRK_V_POINTER, (grp << 2), *v);
+#endif
+#if ENABLE_CAL_CACHE || ENABLE_CAL_HINTS
+	if (grp < RW_MGR_MEM_IF_READ_DQS_WIDTH) {
+		gbl->vfifo[grp] = (gbl->vfifo[grp] + 1) % VFIFO_SIZE;
+	}
 #endif
 	BFM_INC_VFIFO;
 }
@@ -4040,7 +4526,108 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 	
 // Navid's version 
 	
-alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
+//USER DQS enable search state of one read group, kept from one step of the search
+//USER to the next so that the delay sweeps of several groups can go on together
+typedef struct {
+	alt_u32 v, p, d;
+	alt_u32 dtaps_per_ptap;
+	alt_u32 max_working_cnt;
+	alt_u32 work_bgn, work_end;
+#if RUNTIME_CAL_REPORT
+	alt_u32 start_v[NUM_SHADOW_REGS], start_p[NUM_SHADOW_REGS], start_d[NUM_SHADOW_REGS];
+	alt_u32 end_v[NUM_SHADOW_REGS], end_p[NUM_SHADOW_REGS], end_d[NUM_SHADOW_REGS];
+#endif
+} dqs_en_search_t;
+
+#define DQS_EN_ALL_GROUPS	(0xffffffff >> (32 - RW_MGR_MEM_IF_READ_DQS_WIDTH))
+
+//USER Step the DQS enable delay of each group in groups up from s[grp].d, testing each
+//USER setting with num_tries reads, until the test comes out as pass (1 or 0) or the
+//USER delay chain runs out; s[grp].d is left at that setting or past IO_DQS_EN_DELAY_MAX.
+//USER With ENABLE_PARALLEL_GROUPS, while each group is either stepping or parked at a
+//USER setting that passed, one read test of all groups screens the step: an all-groups
+//USER test ORs the errors of the groups, so if it passes every group passes, and if it
+//USER fails the groups are tested one by one.
+//USER With ENABLE_ADAPTIVE_TRIES, a sweep for a failing setting tests each setting once
+//USER and only the one below the failure num_tries times.
+static void dqs_en_delay_sweep (alt_u32 groups, dqs_en_search_t s[], alt_u32 num_tries, alt_u32 pass)
+{
+	alt_u32 grp, active, test_status;
+	alt_u32 tries = pass ? num_tries : READ_TEST_SWEEP_TRIES(num_tries);
+	t_btfld bit_chk;
+#if ENABLE_PARALLEL_GROUPS
+	alt_u32 parked = 0;
+#endif
+#if ENABLE_PARALLEL_GROUPS || ENABLE_ADAPTIVE_TRIES
+	alt_u32 d_bgn[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+
+	for (grp = 0; grp < RW_MGR_MEM_IF_READ_DQS_WIDTH; grp++) {
+		d_bgn[grp] = s[grp].d;
+	}
+#endif
+
+	while (1) {
+		active = 0;
+		for (grp = 0; grp < RW_MGR_MEM_IF_READ_DQS_WIDTH; grp++) {
+			if ((groups & (1 << grp)) && s[grp].d <= IO_DQS_EN_DELAY_MAX) {
+				DPRINT(2, "find_dqs_en_phase: sweep: grp=%lu dtap=%lu", grp, s[grp].d);
+				scc_mgr_set_dqs_en_delay_all_ranks(grp, s[grp].d);
+				active |= 1 << grp;
+			}
+		}
+
+		if (active == 0) {
+			break;
+		}
+
+		test_status = 0;
+#if ENABLE_PARALLEL_GROUPS
+		if ((active & (active - 1)) != 0 && (active | parked) == DQS_EN_ALL_GROUPS) {
+			test_status = rw_mgr_mem_calibrate_read_test_all_ranks (0, tries, PASS_ONE_BIT, &bit_chk, READ_TEST_ALL_GROUPS_FULL);
+		}
+#endif
+
+		for (grp = 0; grp < RW_MGR_MEM_IF_READ_DQS_WIDTH; grp++) {
+			if (!(active & (1 << grp))) {
+				continue;
+			}
+
+			if ((test_status || rw_mgr_mem_calibrate_read_test_all_ranks (grp, tries, PASS_ONE_BIT, &bit_chk, 0)) != pass) {
+				s[grp].d++;
+				continue;
+			}
+
+#if ENABLE_ADAPTIVE_TRIES
+			//USER The edge is where the setting below passes all num_tries
+			while (tries < num_tries && s[grp].d > d_bgn[grp]) {
+				DPRINT(2, "find_dqs_en_phase: sweep: confirm grp=%lu dtap=%lu", grp, s[grp].d - 1);
+				scc_mgr_set_dqs_en_delay_all_ranks(grp, s[grp].d - 1);
+				if (rw_mgr_mem_calibrate_read_test_confirm (grp, num_tries, PASS_ONE_BIT, &bit_chk, 0)) {
+					break;
+				}
+				s[grp].d--;
+			}
+#endif
+
+			//USER Done with this group; leave it somewhere that passes for the screen
+			groups &= ~(1 << grp);
+#if ENABLE_PARALLEL_GROUPS
+			if (pass) {
+				parked |= 1 << grp;
+			} else if (s[grp].d > d_bgn[grp]) {
+				scc_mgr_set_dqs_en_delay_all_ranks(grp, (d_bgn[grp] + s[grp].d - 1) / 2);
+				parked |= 1 << grp;
+			}
+#endif
+		}
+	}
+}
+
+
+//USER Steps 0 to 5 of the DQS enable search of one group: find the beginning of
+//USER the window, then the phase its end is in, leaving s where the delay sweep for
+//USER the end starts
+static alt_u32 dqs_en_find_begin (alt_u32 grp, dqs_en_search_t *s)
 {
 	alt_u32 i, d, v, p, sr, j;
 	alt_u32 max_working_cnt;
@@ -4048,20 +4635,16 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 	t_btfld bit_chk;
 	alt_u32 dtaps_per_ptap;
 	alt_u32 found_begin, found_end;
-	alt_u32 work_bgn, work_mid, work_end, tmp_delay;
+	alt_u32 work_bgn, work_end, tmp_delay;
 	alt_u32 test_status;
-	alt_u32 found_passing_read, found_failing_read, initial_failing_dtap;
 #if RUNTIME_CAL_REPORT
-	alt_u32 start_v[NUM_SHADOW_REGS], start_p[NUM_SHADOW_REGS], start_d[NUM_SHADOW_REGS];
-	alt_u32 end_v[NUM_SHADOW_REGS], end_p[NUM_SHADOW_REGS], end_d[NUM_SHADOW_REGS];
 	for(sr = 0; sr < NUM_SHADOW_REGS; sr++)	{
-		start_v[sr] = 0;
-		start_p[sr] = 0;
-		start_d[sr] = 0;
+		s->start_v[sr] = 0;
+		s->start_p[sr] = 0;
+		s->start_d[sr] = 0;
 	}
 #endif	
 
-	TRACE_FUNC("%lu", grp);
 	BFM_STAGE("find_dqs_en_phase");
 	ALTERA_ASSERT(grp < RW_MGR_MEM_IF_READ_DQS_WIDTH);
 
@@ -4117,6 +4700,17 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 	flag_di_buffer_done();
 #endif
 
+#if ENABLE_CAL_HINTS
+	//USER Start two VFIFO cycles before the window began last time, rather than
+	//USER wherever the VFIFO is, so step 2 has only those cycles to search
+	if (cal_hints.valid) {
+		v = 0;
+		while (gbl->vfifo[grp] != (cal_hints.vfifo[grp] + VFIFO_SIZE - 2) % VFIFO_SIZE) {
+			rw_mgr_incr_vfifo(grp, &v);
+		}
+	}
+#endif
+
 	//USER *********************************************************
 	//USER * Step 1 : First push vfifo until we get a failing read *
 	for (v = 0; v < VFIFO_SIZE; ) {
@@ -4166,6 +4760,9 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 				if (test_status) {
 					max_working_cnt = 1;
 					found_begin = 1;
+#if ENABLE_CAL_HINTS
+					cal_hints.vfifo[grp] = gbl->vfifo[grp];
+#endif
 					break;
 				}
 			}
@@ -4274,9 +4871,9 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 				TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].delay_begin, d);
 				TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].vfifo_begin, v % VFIFO_SIZE);
 #if RUNTIME_CAL_REPORT
-				start_v[sr] = v % VFIFO_SIZE;
-				start_p[sr] = p;
-				start_d[sr] = d;
+				s->start_v[sr] = v % VFIFO_SIZE;
+				s->start_p[sr] = p;
+				s->start_d[sr] = d;
 #endif
 		}
 		else if (p == IO_DQS_EN_PHASE_MAX)
@@ -4285,9 +4882,9 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 				TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].delay_begin, 0);
 				TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].vfifo_begin, (v+1) % VFIFO_SIZE);
 #if RUNTIME_CAL_REPORT
-				start_v[sr] = (v+1) % VFIFO_SIZE;
-				start_p[sr] = p;
-				start_d[sr] = d;
+				s->start_v[sr] = (v+1) % VFIFO_SIZE;
+				s->start_p[sr] = p;
+				s->start_d[sr] = d;
 #endif
 		}
 		else
@@ -4296,9 +4893,9 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 				TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].delay_begin, 0);
 				TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].vfifo_begin, v % VFIFO_SIZE);
 #if RUNTIME_CAL_REPORT
-				start_v[sr] = v % VFIFO_SIZE;
-				start_p[sr] = p+1;
-				start_d[sr] = d;
+				s->start_v[sr] = v % VFIFO_SIZE;
+				s->start_p[sr] = p+1;
+				s->start_d[sr] = d;
 #endif
 			}
 		}
@@ -4424,128 +5021,195 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 		max_working_cnt++;
 	}
 
-	//USER The dtap increment to find the failing edge is done here
-	for (; d <= IO_DQS_EN_DELAY_MAX; d++, work_end += IO_DELAY_PER_DQS_EN_DCHAIN_TAP) {
-
-			DPRINT(2, "find_dqs_en_phase: end-2: dtap=%lu", d);
+#if ENABLE_CAL_HINTS
+	//USER Start below the delay that failed last time, coming down until one passes,
+	//USER and go on up from there as usual
+	if (cal_hints.valid && d == 0 && cal_hints.dqs_en_delay_end[grp] > 1 && cal_hints.dqs_en_delay_end[grp] <= IO_DQS_EN_DELAY_MAX) {
+		for (d = cal_hints.dqs_en_delay_end[grp] - 1; d > 0; d--) {
+			DPRINT(2, "find_dqs_en_phase: end-2 hint: dtap=%lu", d);
 			scc_mgr_set_dqs_en_delay_all_ranks(grp, d);
 
-			if (!rw_mgr_mem_calibrate_read_test_all_ranks (grp, 5, PASS_ONE_BIT, &bit_chk, 0)) {
+			if (rw_mgr_mem_calibrate_read_test_all_ranks (grp, 5, PASS_ONE_BIT, &bit_chk, 0)) {
 				break;
 			}
 		}
+		work_end += d * IO_DELAY_PER_DQS_EN_DCHAIN_TAP;
+	}
+#endif
 
-	//USER Go back to working dtap 
-	if (d != 0) {
-		work_end -= IO_DELAY_PER_DQS_EN_DCHAIN_TAP;
-	} 
+	s->v = v;
+	s->p = p;
+	s->d = d;
+	s->dtaps_per_ptap = dtaps_per_ptap;
+	s->max_working_cnt = max_working_cnt;
+	s->work_bgn = work_bgn;
+	s->work_end = work_end;
+	return 1;
+}
+
+//USER Step 5, the delay part: sweep the DQS enable delay of the groups in groups up to
+//USER the end of their windows.  Returns the groups that found a working range.
+static alt_u32 dqs_en_find_end (alt_u32 groups, dqs_en_search_t s[])
+{
+	alt_u32 grp, v, p, d, sr;
+	alt_u32 work_bgn, work_end;
+	alt_u32 d_bgn[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+
+	//USER The dtap increment to find the failing edge is done here
+	for (grp = 0; grp < RW_MGR_MEM_IF_READ_DQS_WIDTH; grp++) {
+		d_bgn[grp] = s[grp].d;
+	}
+	dqs_en_delay_sweep (groups, s, 5, 0);
+
+	for (grp = 0; grp < RW_MGR_MEM_IF_READ_DQS_WIDTH; grp++) {
+		if (!(groups & (1 << grp))) {
+			continue;
+		}
+
+		v = s[grp].v;
+		p = s[grp].p;
+		d = s[grp].d;
+		work_bgn = s[grp].work_bgn;
+		work_end = s[grp].work_end + (d - d_bgn[grp]) * IO_DELAY_PER_DQS_EN_DCHAIN_TAP;
+#if ENABLE_CAL_HINTS
+		cal_hints.dqs_en_delay_end[grp] = d;
+#endif
+
+		//USER Go back to working dtap 
+		if (d != 0) {
+			work_end -= IO_DELAY_PER_DQS_EN_DCHAIN_TAP;
+		} 
 		
-	DPRINT(2, "find_dqs_en_phase: found end v/p/d: vfifo=%lu ptap=%lu dtap=%lu end=%lu", BFM_GBL_GET(vfifo_idx), p, d-1, work_end);
-	BFM_GBL_SET(dqs_enable_right_edge[grp].v,BFM_GBL_GET(vfifo_idx));
-	BFM_GBL_SET(dqs_enable_right_edge[grp].p,p);
-	BFM_GBL_SET(dqs_enable_right_edge[grp].d,d-1);
-	BFM_GBL_SET(dqs_enable_right_edge[grp].ps,work_end);
-
-	// Record the debug data
-	for (sr = 0; sr < NUM_SHADOW_REGS; sr++)
-	{
-		TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].work_end, work_end);
-		TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].phase_end, p);
-		TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].delay_end, d-1);
-		TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].vfifo_end, v % VFIFO_SIZE);
+		DPRINT(2, "find_dqs_en_phase: found end v/p/d: vfifo=%lu ptap=%lu dtap=%lu end=%lu", BFM_GBL_GET(vfifo_idx), p, d-1, work_end);
+		BFM_GBL_SET(dqs_enable_right_edge[grp].v,BFM_GBL_GET(vfifo_idx));
+		BFM_GBL_SET(dqs_enable_right_edge[grp].p,p);
+		BFM_GBL_SET(dqs_enable_right_edge[grp].d,d-1);
+		BFM_GBL_SET(dqs_enable_right_edge[grp].ps,work_end);
+
+		// Record the debug data
+		for (sr = 0; sr < NUM_SHADOW_REGS; sr++)
+		{
+			TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].work_end, work_end);
+			TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].phase_end, p);
+			TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].delay_end, d-1);
+			TCLRPT_SET(debug_cal_report->cal_dqsen_margins[sr][grp].vfifo_end, v % VFIFO_SIZE);
 #if RUNTIME_CAL_REPORT
-		end_v[sr] = v % VFIFO_SIZE;
-		end_p[sr] = p;
-		end_d[sr] = d-1;
+			s[grp].end_v[sr] = v % VFIFO_SIZE;
+			s[grp].end_p[sr] = p;
+			s[grp].end_d[sr] = d-1;
 #endif
-	}
+		}
 
-	if (work_end >= work_bgn) {
-		//USER we have a working range 
-	} else {
-		//USER nil range 
-		DPRINT(2, "find_dqs_en_phase: end-2: failed");
-		return 0;
+		if (work_end >= work_bgn) {
+			//USER we have a working range 
+		} else {
+			//USER nil range 
+			DPRINT(2, "find_dqs_en_phase: end-2: failed");
+			groups &= ~(1 << grp);
+			continue;
+		}
+
+		DPRINT(2, "find_dqs_en_phase: found range [%lu,%lu]", work_bgn, work_end);
+		s[grp].work_end = work_end;
 	}
-	
-	DPRINT(2, "find_dqs_en_phase: found range [%lu,%lu]", work_bgn, work_end);
 
-#if USE_DQS_TRACKING
-	// ***************************************************************
-	//USER * We need to calculate the number of dtaps that equal a ptap
-	//USER * To do that we'll back up a ptap and re-find the edge of the 
-	//USER * window using dtaps
+	return groups;
+}
+
+#if USE_DQS_TRACKING
+//USER We need to calculate the number of dtaps that equal a ptap.  To do that we'll back
+//USER up a ptap in each of the groups and re-find the edge of the window using dtaps
+static void dqs_en_find_dtaps_per_ptap (alt_u32 groups, dqs_en_search_t s[])
+{
+	alt_u32 grp, passing;
+	alt_u32 initial_failing_dtap[RW_MGR_MEM_IF_READ_DQS_WIDTH];
 
 	DPRINT(2, "find_dqs_en_phase: calculate dtaps_per_ptap for tracking");
-	
-	//USER Special case code for backing up a phase 
-	
+
+	for (grp = 0; grp < RW_MGR_MEM_IF_READ_DQS_WIDTH; grp++) {
+		if (!(groups & (1 << grp))) {
+			continue;
+		}
+
+		//USER Special case code for backing up a phase 
 #if SKIP_PTAP_0_DQS_EN_CAL	
-	if (p == 0 || p == 1) {
+		if (s[grp].p == 0 || s[grp].p == 1) {
 #else
-	if (p == 0) {
+		if (s[grp].p == 0) {
 #endif
-		p = IO_DQS_EN_PHASE_MAX;
-		rw_mgr_decr_vfifo(grp, &v);
-		DPRINT(2, "find_dqs_en_phase: backed up cycle/phase: v=%lu p=%lu", BFM_GBL_GET(vfifo_idx), p);
-	} else {
-		p = p - 1;
-		DPRINT(2, "find_dqs_en_phase: backed up phase only: v=%lu p=%lu", BFM_GBL_GET(vfifo_idx), p);
+			s[grp].p = IO_DQS_EN_PHASE_MAX;
+			rw_mgr_decr_vfifo(grp, &s[grp].v);
+			DPRINT(2, "find_dqs_en_phase: backed up cycle/phase: v=%lu p=%lu", BFM_GBL_GET(vfifo_idx), s[grp].p);
+		} else {
+			s[grp].p = s[grp].p - 1;
+			DPRINT(2, "find_dqs_en_phase: backed up phase only: v=%lu p=%lu", BFM_GBL_GET(vfifo_idx), s[grp].p);
+		}
+
+		scc_mgr_set_dqs_en_phase_all_ranks(grp, s[grp].p);
+		initial_failing_dtap[grp] = s[grp].d;
 	}
-	
-	scc_mgr_set_dqs_en_phase_all_ranks(grp, p);
-	
+
 	//USER Increase dtap until we first see a passing read (in case the window is smaller than a ptap),
 	//USER and then a failing read to mark the edge of the window again
-	
+
 	//USER Find a passing read
 	DPRINT(2, "find_dqs_en_phase: find passing read");
-	found_passing_read = 0;
-   	found_failing_read = 0;
-	initial_failing_dtap = d;
-	for (; d <= IO_DQS_EN_DELAY_MAX; d++) {
-		DPRINT(2, "find_dqs_en_phase: testing read d=%lu", d);
-		scc_mgr_set_dqs_en_delay_all_ranks(grp, d);
+	dqs_en_delay_sweep (groups, s, 1, 1);
 
-		if (rw_mgr_mem_calibrate_read_test_all_ranks (grp, 1, PASS_ONE_BIT, &bit_chk, 0)) {
-			found_passing_read = 1;
-			break;
+	passing = 0;
+	for (grp = 0; grp < RW_MGR_MEM_IF_READ_DQS_WIDTH; grp++) {
+		if (!(groups & (1 << grp))) {
+			continue;
 		}
-	}
-	
-	if (found_passing_read) {
-	   //USER Find a failing read 
-	   DPRINT(2, "find_dqs_en_phase: find failing read");
-	   for (d = d + 1; d <= IO_DQS_EN_DELAY_MAX; d++) {
-	   	DPRINT(2, "find_dqs_en_phase: testing read d=%lu", d);
-	   	scc_mgr_set_dqs_en_delay_all_ranks(grp, d);
 
-	   	if (!rw_mgr_mem_calibrate_read_test_all_ranks (grp, 1, PASS_ONE_BIT, &bit_chk, 0)) {
-	   		found_failing_read = 1;
-	   		break;
-	   	}
-	   }	
-   } else {
-      DPRINT(1, "find_dqs_en_phase: failed to calculate dtaps per ptap. Fall back on static value");
+		if (s[grp].d <= IO_DQS_EN_DELAY_MAX) {
+			passing |= 1 << grp;
+			s[grp].d++;
+		} else {
+			DPRINT(1, "find_dqs_en_phase: failed to calculate dtaps per ptap. Fall back on static value");
+		}
 	}
 
-	//USER The dynamically calculated dtaps_per_ptap is only valid if we found a passing/failing read
-	//USER If we didn't, it means d hit the max (IO_DQS_EN_DELAY_MAX).
-   //USER Otherwise, dtaps_per_ptap retains its statically calculated value.
-	if(found_passing_read && found_failing_read) {
-      dtaps_per_ptap = d - initial_failing_dtap;
-   }
+	//USER Find a failing read 
+	DPRINT(2, "find_dqs_en_phase: find failing read");
+	dqs_en_delay_sweep (passing, s, 1, 0);
 
-	ALTERA_ASSERT(dtaps_per_ptap <= IO_DQS_EN_DELAY_MAX);
+	for (grp = 0; grp < RW_MGR_MEM_IF_READ_DQS_WIDTH; grp++) {
+		if (!(groups & (1 << grp))) {
+			continue;
+		}
+
+		//USER The dynamically calculated dtaps_per_ptap is only valid if we found a passing/failing read
+		//USER If we didn't, it means d hit the max (IO_DQS_EN_DELAY_MAX).
+		//USER Otherwise, dtaps_per_ptap retains its statically calculated value.
+		if ((passing & (1 << grp)) && s[grp].d <= IO_DQS_EN_DELAY_MAX) {
+			s[grp].dtaps_per_ptap = s[grp].d - initial_failing_dtap[grp];
+		}
+
+		ALTERA_ASSERT(s[grp].dtaps_per_ptap <= IO_DQS_EN_DELAY_MAX);
 #if HHP_HPS
-	IOWR_32DIRECT (REG_FILE_DTAPS_PER_PTAP, 0, dtaps_per_ptap);
+		IOWR_32DIRECT (REG_FILE_DTAPS_PER_PTAP, 0, s[grp].dtaps_per_ptap);
 #else
-	IOWR_32DIRECT (TRK_DTAPS_PER_PTAP, 0, dtaps_per_ptap);
+		IOWR_32DIRECT (TRK_DTAPS_PER_PTAP, 0, s[grp].dtaps_per_ptap);
 #endif
 
-	DPRINT(2, "find_dqs_en_phase: dtaps_per_ptap=%lu - %lu = %lu", d, initial_failing_dtap, dtaps_per_ptap);
+		DPRINT(2, "find_dqs_en_phase: dtaps_per_ptap=%lu - %lu = %lu", s[grp].d, initial_failing_dtap[grp], s[grp].dtaps_per_ptap);
+	}
+}
 #endif
-	
+
+
+//USER Step 6: set the DQS enable of one group to the centre of its window
+static alt_u32 dqs_en_find_center (alt_u32 grp, dqs_en_search_t *s)
+{
+	alt_u32 i, d, v, p, sr;
+	t_btfld bit_chk;
+	alt_u32 work_bgn, work_mid, work_end, tmp_delay;
+
+	v = s->v;
+	work_bgn = s->work_bgn;
+	work_end = s->work_end;
+
 	//USER ********************************************
 	//USER * step 6:  Find the centre of the window   *
 		
@@ -4567,7 +5231,7 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 	
 	// DQSEN same for all shadow reg
 	for(sr = 0; sr < NUM_SHADOW_REGS; sr++) {
-		TCLRPT_SET(debug_cal_report->cal_dqs_in_margins[sr][grp].dqsen_margin, max_working_cnt -1);
+		TCLRPT_SET(debug_cal_report->cal_dqs_in_margins[sr][grp].dqsen_margin, s->max_working_cnt -1);
 	}
 #if SKIP_PTAP_0_DQS_EN_CAL	
 		if (p == 1) {
@@ -4598,8 +5262,8 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 	}
 #if RUNTIME_CAL_REPORT
 	for(sr = 0; sr < NUM_SHADOW_REGS; sr++) {
-		RPRINT("DQS Enable ; Group %lu ; Rank %lu ; Start  VFIFO %2li ; Phase %li ; Delay %2li", grp, sr, start_v[sr], start_p[sr], start_d[sr]);
-		RPRINT("DQS Enable ; Group %lu ; Rank %lu ; End    VFIFO %2li ; Phase %li ; Delay %2li", grp, sr, end_v[sr], end_p[sr], end_d[sr]);
+		RPRINT("DQS Enable ; Group %lu ; Rank %lu ; Start  VFIFO %2li ; Phase %li ; Delay %2li", grp, sr, s->start_v[sr], s->start_p[sr], s->start_d[sr]);
+		RPRINT("DQS Enable ; Group %lu ; Rank %lu ; End    VFIFO %2li ; Phase %li ; Delay %2li", grp, sr, s->end_v[sr], s->end_p[sr], s->end_d[sr]);
       // Case 174276: Normalizing VFIFO center
 		RPRINT("DQS Enable ; Group %lu ; Rank %lu ; Center VFIFO %2li ; Phase %li ; Delay %2li", grp, sr, (v % VFIFO_SIZE), p-1, d);
 	}
@@ -4615,6 +5279,36 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 	return 1;
 }
 
+#if ENABLE_PARALLEL_GROUPS
+//USER Read groups whose DQS enable rw_mgr_mem_calibrate_dqs_en_all_groups has set
+static alt_u32 dqs_en_groups_found;
+#endif
+
+alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
+{
+	dqs_en_search_t s[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+
+	TRACE_FUNC("%lu", grp);
+
+#if ENABLE_PARALLEL_GROUPS
+	if (dqs_en_groups_found & (1 << grp)) {
+		//USER Found with the other groups; only the first attempt gets to use it
+		dqs_en_groups_found &= ~(1 << grp);
+		return 1;
+	}
+#endif
+
+	if (!dqs_en_find_begin (grp, &s[grp]) || !dqs_en_find_end (1 << grp, s)) {
+		return 0;
+	}
+
+#if USE_DQS_TRACKING
+	dqs_en_find_dtaps_per_ptap (1 << grp, s);
+#endif
+
+	return dqs_en_find_center (grp, &s[grp]);
+}
+
 #if 0
 // Ryan's algorithm 
 
@@ -5040,21 +5734,14 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase (alt_u32 grp)
 #endif
 
 
-// Try rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase across different dq_in_delay values
-static inline alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase_sweep_dq_in_delay (alt_u32 write_group, alt_u32 read_group, alt_u32 test_bgn)
-{
 #if STRATIXV || ARRIAV || CYCLONEV || ARRIAVGZ
-	alt_u32 found;
+//USER Set the DQ in delays of a read group delay_step apart, from zero up, or all to zero
+static void rw_mgr_mem_calibrate_vfifo_set_dq_in_delay_steps (alt_u32 write_group, alt_u32 read_group, alt_u32 test_bgn, alt_u32 delay_step)
+{
 	alt_u32 i;
 	alt_u32 p;
 	alt_u32 d;
 	alt_u32 r;
-		
-	const alt_u32 delay_step = IO_IO_IN_DELAY_MAX/(RW_MGR_MEM_DQ_PER_READ_DQS-1); /* we start at zero, so have one less dq to devide among */
-	
-	TRACE_FUNC("(%lu,%lu,%lu)", write_group, read_group, test_bgn);
-
-	// try different dq_in_delays since the dq path is shorter than dqs
 
 	for (r = 0; r < RW_MGR_MEM_NUMBER_OF_RANKS; r += NUM_RANKS_PER_SHADOW_REG) {
 		select_shadow_regs_for_update(r, write_group, 1);
@@ -5066,20 +5753,29 @@ static inline alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase_sweep_dq_in_d
 		}
 		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
 	}
+}
+#endif
+
+// Try rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase across different dq_in_delay values
+static inline alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase_sweep_dq_in_delay (alt_u32 write_group, alt_u32 read_group, alt_u32 test_bgn)
+{
+#if STRATIXV || ARRIAV || CYCLONEV || ARRIAVGZ
+	alt_u32 found;
+		
+	const alt_u32 delay_step = IO_IO_IN_DELAY_MAX/(RW_MGR_MEM_DQ_PER_READ_DQS-1); /* we start at zero, so have one less dq to devide among */
+	
+	TRACE_FUNC("(%lu,%lu,%lu)", write_group, read_group, test_bgn);
+
+	// try different dq_in_delays since the dq path is shorter than dqs
+
+	rw_mgr_mem_calibrate_vfifo_set_dq_in_delay_steps (write_group, read_group, test_bgn, delay_step);
 
 	found = rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase(read_group);
 
 	DPRINT(1, "rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase_sweep_dq_in_delay: g=%lu/%lu found=%lu; Reseting delay chain to zero",
 	       write_group, read_group, found);
 
-	for (r = 0; r < RW_MGR_MEM_NUMBER_OF_RANKS; r += NUM_RANKS_PER_SHADOW_REG) {
-		select_shadow_regs_for_update(r, write_group, 1);
-		for (i = 0, p = test_bgn; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++, p++) {
-			scc_mgr_set_dq_in_delay(write_group, p, 0);
-			scc_mgr_load_dq (p);
-		}
-		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
-	}
+	rw_mgr_mem_calibrate_vfifo_set_dq_in_delay_steps (write_group, read_group, test_bgn, 0);
 
 	return found;
 #else
@@ -5087,6 +5783,231 @@ static inline alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase_sweep_dq_in_d
 #endif
 }
 
+#if ENABLE_PARALLEL_GROUPS
+//USER Find the DQS enable settings of the read groups in run_groups (one bit per write
+//USER group, as param->skip_groups) together, as rw_mgr_mem_calibrate_vfifo would find
+//USER them on its first try, and note them in dqs_en_groups_found for it to use.  The
+//USER beginning of each window and the centre are found a group at a time; the delay
+//USER sweeps to the end of the windows, which pass until they reach it, go on together.
+//USER If a group fails its guaranteed read, its first try would stop there and retry at
+//USER other phases, so the pass is skipped and every group gets the usual search.
+static void rw_mgr_mem_calibrate_dqs_en_all_groups (alt_u32 run_groups)
+{
+	dqs_en_search_t s[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+	alt_u32 tried = 0, groups = 0;
+	alt_u32 write_group, read_group, test_bgn;
+#if DDRX && !AP_MODE
+	t_btfld bit_chk;
+#endif
+#if STRATIXV || ARRIAV || CYCLONEV || ARRIAVGZ
+	const alt_u32 delay_step = IO_IO_IN_DELAY_MAX/(RW_MGR_MEM_DQ_PER_READ_DQS-1);
+#endif
+
+	TRACE_FUNC("0x%lx", run_groups);
+
+	dqs_en_groups_found = 0;
+	reg_file_set_stage(CAL_STAGE_VFIFO);
+	rw_mgr_mem_calibrate_read_load_patterns_all_ranks ();
+
+#if DDRX && !AP_MODE
+	for (write_group = 0, groups = run_groups; write_group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH; write_group++, groups >>= RW_MGR_NUM_DQS_PER_WRITE_GROUP) {
+		if ((groups & ((1 << RW_MGR_NUM_DQS_PER_WRITE_GROUP) - 1)) == 0 ||
+		    (gbl->phy_debug_mode_flags & PHY_DEBUG_DISABLE_GUARANTEED_READ)) {
+			continue;
+		}
+
+		IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, write_group);
+
+		for (read_group = write_group * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH;
+		     read_group < (write_group + 1) * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH;
+		     read_group++) {
+			if (!rw_mgr_mem_calibrate_read_test_patterns_all_ranks (read_group, 1, &bit_chk)) {
+				DPRINT(1, "dqs_en_all_groups: guaranteed read failed: g=%lu", read_group);
+				return;
+			}
+		}
+	}
+	groups = 0;
+#endif
+
+	for (write_group = 0; write_group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH; write_group++, run_groups >>= RW_MGR_NUM_DQS_PER_WRITE_GROUP) {
+		if ((run_groups & ((1 << RW_MGR_NUM_DQS_PER_WRITE_GROUP) - 1)) == 0) {
+			continue;
+		}
+
+		IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, write_group);
+
+		for (read_group = write_group * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH, test_bgn = 0;
+		     read_group < (write_group + 1) * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH;
+		     read_group++, test_bgn += RW_MGR_MEM_DQ_PER_READ_DQS) {
+			reg_file_set_group(read_group);
+#if STRATIXV || ARRIAV || CYCLONEV || ARRIAVGZ
+			rw_mgr_mem_calibrate_vfifo_set_dq_in_delay_steps (write_group, read_group, test_bgn, delay_step);
+#endif
+			tried |= 1 << read_group;
+			if (dqs_en_find_begin (read_group, &s[read_group])) {
+				groups |= 1 << read_group;
+			}
+		}
+	}
+
+	groups = dqs_en_find_end (groups, s);
+
+#if USE_DQS_TRACKING
+	dqs_en_find_dtaps_per_ptap (groups, s);
+#endif
+
+	for (write_group = 0; write_group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH; write_group++) {
+		IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, write_group);
+
+		for (read_group = write_group * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH, test_bgn = 0;
+		     read_group < (write_group + 1) * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH;
+		     read_group++, test_bgn += RW_MGR_MEM_DQ_PER_READ_DQS) {
+			if (groups & (1 << read_group)) {
+				reg_file_set_group(read_group);
+				if (!dqs_en_find_center (read_group, &s[read_group])) {
+					groups &= ~(1 << read_group);
+				}
+			}
+#if STRATIXV || ARRIAV || CYCLONEV || ARRIAVGZ
+			if (tried & (1 << read_group)) {
+				rw_mgr_mem_calibrate_vfifo_set_dq_in_delay_steps (write_group, read_group, test_bgn, 0);
+			}
+#endif
+		}
+	}
+
+	//USER Groups that failed here get the usual search when their turn comes
+	dqs_en_groups_found = groups;
+}
+#endif
+
+//USER One side of a per-bit deskew search.  test moves it d taps in, runs a test and
+//USER returns the bits that passed; side 0 moves the DQ delays, side 1 the DQS delay.
+typedef struct deskew_search {
+	t_btfld (*test) (struct deskew_search *s, alt_32 d);
+	alt_u32 rank_bgn;
+	alt_u32 write_group;
+	alt_u32 test_bgn;
+	alt_u32 side;
+	alt_32 start_dqs;
+	alt_u32 bits;
+	t_btfld correct_mask;
+} deskew_search_t;
+
+#if WRITE_DESKEW_STRIDE > 1
+
+//USER Find the window of passing settings of each bit along one side of a deskew search
+//USER (d from 0 to d_max) without testing every tap.  Step stride taps at a time until
+//USER every bit has passed and all fail again, where the tap-by-tap search stops, then
+//USER bisect the strides that hold the edges.  A probe tests all bits, so bits whose edges
+//USER share a stride share its probes.  Bits already set in sticky_bit_chk need not pass.
+//USER Returns 0 if some other bit never passed: its window may lie between two strides.
+static alt_u32 deskew_find_windows (deskew_search_t *s, alt_32 stride, alt_32 d_max, t_btfld sticky_bit_chk, alt_32 win_bgn[], alt_32 win_end[])
+{
+	alt_u32 i, k;
+	alt_32 d;
+	t_btfld bit_chk;
+	//USER Edges still to find: the end of each bit's window lies in (lo, hi] from the last passing
+	//USER stride, the beginning in [lo, hi) before the first one
+	alt_32 lo[2 * RW_MGR_MEM_DQ_PER_WRITE_DQS];
+	alt_32 hi[2 * RW_MGR_MEM_DQ_PER_WRITE_DQS];
+
+	for (i = 0; i < s->bits; i++) {
+		win_bgn[i] = d_max + 1;
+		win_end[i] = -1;
+	}
+
+	for (d = 0; d <= d_max; d += stride) {
+		bit_chk = s->test (s, d);
+		sticky_bit_chk = sticky_bit_chk | bit_chk;
+		DPRINT(2, "deskew(%lu,coarse): dtap=%ld => " BTFLD_FMT " sticky " BTFLD_FMT, s->side, d, bit_chk, sticky_bit_chk);
+		if (bit_chk == 0 && sticky_bit_chk == s->correct_mask) {
+			break;
+		}
+		for (i = 0; i < s->bits; i++, bit_chk >>= 1) {
+			if (bit_chk & 1) {
+				if (win_end[i] < 0) {
+					win_bgn[i] = d;
+				}
+				win_end[i] = d;
+			}
+		}
+	}
+
+	if (sticky_bit_chk != s->correct_mask) {
+		DPRINT(1, "deskew(%lu): a window fell between strides; searching every tap", s->side);
+		return 0;
+	}
+
+	for (i = 0; i < s->bits; i++) {
+		k = s->bits + i;
+		lo[i] = win_end[i];
+		hi[i] = win_end[i];
+		if (win_end[i] >= 0) {
+			hi[i] = win_end[i] + stride;
+			if (hi[i] > d_max + 1) {
+				hi[i] = d_max + 1;
+			}
+		}
+		lo[k] = win_bgn[i];
+		hi[k] = win_bgn[i];
+		if (win_bgn[i] > 0 && win_bgn[i] <= d_max) {
+			lo[k] = win_bgn[i] - stride;
+		}
+	}
+
+	for (;;) {
+		for (k = 0; k < 2 * s->bits && hi[k] - lo[k] <= 1; k++);
+		if (k == 2 * s->bits) {
+			break;
+		}
+
+		d = (lo[k] + hi[k]) / 2;
+		bit_chk = s->test (s, d);
+		DPRINT(2, "deskew(%lu,fine): dtap=%ld => " BTFLD_FMT, s->side, d, bit_chk);
+
+		for (i = 0; i < s->bits; i++, bit_chk >>= 1) {
+			k = s->bits + i;
+			if (lo[i] < d && d < hi[i]) {
+				if (bit_chk & 1) {
+					lo[i] = d;
+				} else {
+					hi[i] = d;
+				}
+			}
+			if (lo[k] < d && d < hi[k]) {
+				if (bit_chk & 1) {
+					hi[k] = d;
+				} else {
+					lo[k] = d;
+				}
+			}
+		}
+	}
+
+	for (i = 0; i < s->bits; i++) {
+		win_end[i] = lo[i];
+		win_bgn[i] = hi[s->bits + i];
+		DPRINT(2, "deskew(%lu): window[%lu]=[%ld,%ld]", s->side, i, win_bgn[i], win_end[i]);
+	}
+	return 1;
+}
+
+//USER The bits whose windows hold d, as a test at d would have passed them
+static t_btfld deskew_window_bits (deskew_search_t *s, alt_32 win_bgn[], alt_32 win_end[], alt_32 d)
+{
+	alt_u32 i;
+	t_btfld bit_chk = 0;
+
+	for (i = s->bits; i-- > 0;) {
+		bit_chk = (bit_chk << 1) | (win_bgn[i] <= d && d <= win_end[i]);
+	}
+	return bit_chk;
+}
+
+#endif
+
 //USER per-bit deskew DQ and center 
 
 #if NEWVERSION_RDDESKEW
@@ -5107,6 +6028,7 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_center (alt_u32 rank_bgn, alt_u32 write_group
 	alt_u32 stop;
 
 	TRACE_FUNC("%lu %lu", read_group, test_bgn);
+	CAL_PROFILE_DESKEW(1);
 #if BFM_MODE	
 	if (use_read_test) {
 		BFM_STAGE("vfifo_center");
@@ -5293,6 +6215,7 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_center (alt_u32 rank_bgn, alt_u32 write_group
 			} else {
 				set_failing_group_stage(read_group*RW_MGR_MEM_DQ_PER_READ_DQS + i, CAL_STAGE_VFIFO_AFTER_WRITES, CAL_SUBSTAGE_VFIFO_CENTER);
 			}
+			CAL_PROFILE_DESKEW(0);
 			return 0;
 		}
 	}
@@ -5440,6 +6363,7 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_center (alt_u32 rank_bgn, alt_u32 write_group
 
 	//USER Do not remove this line as it makes sure all of our decisions have been applied
 	IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);	
+	CAL_PROFILE_DESKEW(0);
 	return (dq_margin >= 0) && (dqs_margin >= 0);
 }
 
@@ -5834,6 +6758,10 @@ alt_u32 rw_mgr_mem_calibrate_vfifo (alt_u32 read_group, alt_u32 test_bgn)
 			if (!(gbl->phy_debug_mode_flags & PHY_DEBUG_DISABLE_GUARANTEED_READ)) {
 				if (!rw_mgr_mem_calibrate_read_test_patterns_all_ranks (read_group, 1, &bit_chk)) {
 					DPRINT(1, "Guaranteed read test failed: g=%lu p=%lu d=%lu", read_group, p, d);
+#if ENABLE_PARALLEL_GROUPS
+					//USER The DQS enable found with the other groups held for p=0, d=0 only
+					dqs_en_groups_found &= ~(1 << read_group);
+#endif
 					break;
 				}
 			}
@@ -6045,6 +6973,10 @@ alt_u32 rw_mgr_mem_calibrate_vfifo (alt_u32 g, alt_u32 test_bgn)
 #if DDRX
 		if (!(gbl->phy_debug_mode_flags & PHY_DEBUG_DISABLE_GUARANTEED_READ)) {
 			if (!rw_mgr_mem_calibrate_read_test_patterns_all_ranks (read_group, 1, &bit_chk)) {
+#if ENABLE_PARALLEL_GROUPS
+				//USER The DQS enable found with the other groups held for p=0, d=0 only
+				dqs_en_groups_found &= ~(1 << read_group);
+#endif
 				break;
 			}
 		}
@@ -6145,6 +7077,9 @@ alt_u32 rw_mgr_mem_calibrate_lfifo (void)
 	alt_u32 found_one;
 	t_btfld bit_chk;
 	alt_u32 g;
+#if ENABLE_ADAPTIVE_TRIES
+	alt_u32 start_read_lat;
+#endif
 
 	TRACE_FUNC();
 	BFM_STAGE("lfifo");
@@ -6160,11 +7095,32 @@ alt_u32 rw_mgr_mem_calibrate_lfifo (void)
 
 	found_one = 0;
 
+#if ENABLE_CAL_HINTS
+	//USER Start just above the latency that failed last time, going up while that
+	//USER fails, and come down from there as usual
+	if (cal_hints.valid && cal_hints.read_lat + 1 < gbl->curr_read_lat) {
+		alt_u32 max_read_lat = gbl->curr_read_lat;
+
+		for (gbl->curr_read_lat = cal_hints.read_lat + 1; gbl->curr_read_lat < max_read_lat; gbl->curr_read_lat++) {
+			IOWR_32DIRECT (PHY_MGR_PHY_RLAT, 0, gbl->curr_read_lat);
+			DPRINT(2, "lfifo: hint: read_lat=%lu", gbl->curr_read_lat);
+
+			if (rw_mgr_mem_calibrate_read_test_all_ranks (0, NUM_READ_TESTS, PASS_ALL_BITS, &bit_chk, 1)) {
+				break;
+			}
+		}
+	}
+#endif
+
+#if ENABLE_ADAPTIVE_TRIES
+	start_read_lat = gbl->curr_read_lat;
+#endif
+
 	do {
 		IOWR_32DIRECT (PHY_MGR_PHY_RLAT, 0, gbl->curr_read_lat);
 		DPRINT(2, "lfifo: read_lat=%lu", gbl->curr_read_lat);
 
-		if (!rw_mgr_mem_calibrate_read_test_all_ranks (0, NUM_READ_TESTS, PASS_ALL_BITS, &bit_chk, 1)) {
+		if (!rw_mgr_mem_calibrate_read_test_all_ranks (0, READ_TEST_SWEEP_TRIES(NUM_READ_TESTS), PASS_ALL_BITS, &bit_chk, 1)) {
 			break;
 		}
 
@@ -6176,6 +7132,26 @@ alt_u32 rw_mgr_mem_calibrate_lfifo (void)
 		gbl->curr_read_lat--;
 	} while (gbl->curr_read_lat > 0);
 
+#if ENABLE_ADAPTIVE_TRIES
+	//USER The smallest latency that passed has to pass all NUM_READ_TESTS; go back up while it fails
+	while (found_one) {
+		IOWR_32DIRECT (PHY_MGR_PHY_RLAT, 0, gbl->curr_read_lat + 1);
+		DPRINT(2, "lfifo: confirm read_lat=%lu", gbl->curr_read_lat + 1);
+
+		if (rw_mgr_mem_calibrate_read_test_confirm (0, NUM_READ_TESTS, PASS_ALL_BITS, &bit_chk, 1)) {
+			break;
+		}
+
+		if (++gbl->curr_read_lat == start_read_lat) {
+			found_one = 0;
+		}
+	}
+#endif
+
+#if ENABLE_CAL_HINTS
+	cal_hints.read_lat = gbl->curr_read_lat;
+#endif
+
 	//USER reset the fifos to get pointers to known state 
 
 	IOWR_32DIRECT (PHY_MGR_CMD_FIFO_RESET, 0, 0);
@@ -6422,6 +7398,8 @@ alt_u32 rw_mgr_mem_calibrate_write_test (alt_u32 rank_bgn, alt_u32 write_group,
 	alt_u32 vg;
 	alt_u32 rank_end = all_ranks ? RW_MGR_MEM_NUMBER_OF_RANKS : (rank_bgn + NUM_RANKS_PER_SHADOW_REG);
 
+	CAL_PROFILE_TEST();
+
 	*bit_chk = param->write_correct_mask;
 	correct_mask_vg = param->write_correct_mask_vg;
 
@@ -7203,27 +8181,222 @@ alt_u32 rw_mgr_mem_calibrate_wlevel (alt_u32 g, alt_u32 test_bgn)
 
 	tmp_delay = 0;
 
-	for (p = 0; p <= IO_DQDQS_OUT_PHASE_MAX && tmp_delay < work_mid; p++, tmp_delay += IO_DELAY_PER_OPA_TAP);
+	for (p = 0; p <= IO_DQDQS_OUT_PHASE_MAX && tmp_delay < work_mid; p++, tmp_delay += IO_DELAY_PER_OPA_TAP);
+
+	tmp_delay -= IO_DELAY_PER_OPA_TAP;
+
+	scc_mgr_set_dqdqs_output_phase_all_ranks(g, p - 1);
+
+	for (d = 0; d <= IO_IO_OUT1_DELAY_MAX && tmp_delay < work_mid; d++, tmp_delay += IO_DELAY_PER_DCHAIN_TAP);
+
+	scc_mgr_apply_group_all_out_delay_add_all_ranks (g, test_bgn, d - 1);
+
+
+	return 1;
+}
+
+#endif
+#endif
+#endif
+
+//USER center all windows. do per-bit-deskew to possibly increase size of certain windows
+
+#if NEWVERSION_WRDESKEW
+
+//USER Write deskew test for a deskew_search_t: side 0 sets the DQ out1 delays of the group
+//USER to d, side 1 the DQS (and OCT) out1 delay to start_dqs + d
+static t_btfld rw_mgr_mem_calibrate_writes_center_test (deskew_search_t *s, alt_32 d)
+{
+	t_btfld bit_chk;
+
+	if (s->side == 0) {
+		scc_mgr_apply_group_dq_out1_delay (s->write_group, s->test_bgn, d);
+		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+	} else {
+		scc_mgr_apply_group_dqs_io_and_oct_out1 (s->write_group, d + s->start_dqs);
+		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+		if (QDRII)
+		{
+			rw_mgr_mem_dll_lock_wait();
+		}
+	}
+
+	if (!rw_mgr_mem_calibrate_write_test (s->rank_bgn, s->write_group, 0, PASS_ONE_BIT, &bit_chk, 0) && s->side == 1) {
+		recover_mem_device_after_ck_dqs_violation();
+	}
+	return bit_chk;
+}
+
+#if WRITE_DESKEW_STRIDE > 1
+
+//USER Test again just beyond the edges of the windows deskew_find_windows found for the DQ
+//USER pins, and widen any window that still passes there until it fails.  A bit failing
+//USER once inside its window could otherwise cut the bisection short, where the tap-by-tap
+//USER search would go on to its last pass; this keeps the margins it would find.  Each
+//USER pin's own out1 delay puts it at its edge, so one test checks every bit.  For side 1,
+//USER DQS moves out to the farthest edge and each pin comes in by its distance from there,
+//USER which is the same offset between the pin and DQS.
+static void rw_mgr_mem_calibrate_writes_center_widen (deskew_search_t *s, alt_32 d_max, alt_32 win_bgn[], alt_32 win_end[])
+{
+	alt_u32 i, bgn;
+	alt_32 far, delay;
+	alt_32 at[RW_MGR_MEM_DQ_PER_WRITE_DQS];
+	t_btfld bit_chk, mask;
+
+	//USER Ends first, then for side 0 the beginnings of windows that do not start at 0
+	for (bgn = 0; bgn <= (s->side == 0); bgn++) {
+		do {
+			mask = 0;
+			far = 0;
+			for (i = 0; i < s->bits; i++) {
+				at[i] = bgn ? win_bgn[i] - 1 : win_end[i] + 1;
+				if (win_bgn[i] <= win_end[i] && at[i] >= 0 && at[i] <= d_max) {
+					mask = mask | ((t_btfld)1 << i);
+					if (at[i] > far) {
+						far = at[i];
+					}
+				}
+			}
+			if (mask == 0) {
+				break;
+			}
+
+			if (s->side == 1) {
+				scc_mgr_apply_group_dqs_io_and_oct_out1 (s->write_group, far + s->start_dqs);
+			}
+			for (i = 0; i < s->bits; i++) {
+				delay = 0;
+				if ((mask >> i) & 1) {
+					delay = s->side ? far - at[i] : at[i];
+				}
+				scc_mgr_set_dq_out1_delay(s->write_group, i, delay);
+				scc_mgr_load_dq (i);
+			}
+			IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+			if (QDRII && s->side == 1)
+			{
+				rw_mgr_mem_dll_lock_wait();
+			}
+
+			if (!rw_mgr_mem_calibrate_write_test (s->rank_bgn, s->write_group, 0, PASS_ONE_BIT, &bit_chk, 0) && s->side == 1) {
+				recover_mem_device_after_ck_dqs_violation();
+			}
+			bit_chk = bit_chk & mask;
+			DPRINT(2, "write_center(%lu,widen): " BTFLD_FMT " of " BTFLD_FMT, s->side, bit_chk, mask);
+
+			for (i = 0; i < s->bits; i++) {
+				if ((bit_chk >> i) & 1) {
+					if (bgn) {
+						win_bgn[i] = at[i];
+					} else {
+						win_end[i] = at[i];
+					}
+				}
+			}
+		} while (bit_chk != 0);
+	}
+
+	if (s->side == 1) {
+		scc_mgr_apply_group_dq_out1_delay (s->write_group, s->test_bgn, 0);
+	}
+}
+
+#if DDRX
+
+//USER One test along the DM search: DM out1 delay -p for p < 0, then DQS out1 new_dqs + p
+static alt_u32 rw_mgr_mem_calibrate_dm_test (alt_u32 rank_bgn, alt_u32 write_group, alt_32 new_dqs, alt_32 p)
+{
+	t_btfld bit_chk;
+
+	scc_mgr_apply_group_dm_out1_delay (write_group, p < 0 ? -p : 0);
+	scc_mgr_apply_group_dqs_io_and_oct_out1 (write_group, p > 0 ? new_dqs + p : new_dqs);
+	IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+
+	if (rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 1, PASS_ALL_BITS, &bit_chk, 0)) {
+		DPRINT(2, "dm_calib: p=%ld passed", p);
+		return 1;
+	}
+	DPRINT(2, "dm_calib: p=%ld failed", p);
+	if (p >= 0) {
+		recover_mem_device_after_ck_dqs_violation();
+	}
+	return 0;
+}
+
+//USER Find the DM window along the same settings as the tap-by-tap search in
+//USER rw_mgr_mem_calibrate_writes_center, in strides of WRITE_DESKEW_STRIDE with
+//USER bisection of its two edges.  This assumes one window.  Returns 0 if no stride
+//USER passed, and the tap-by-tap search runs instead.
+static alt_u32 rw_mgr_mem_calibrate_dm_window (alt_u32 rank_bgn, alt_u32 write_group, alt_32 new_dqs, alt_32 *bgn, alt_32 *end)
+{
+	alt_32 p, lo, hi;
+	alt_32 p_min = -IO_IO_OUT1_DELAY_MAX;
+	alt_32 p_max = IO_IO_OUT1_DELAY_MAX - new_dqs;
+	alt_32 first = p_max + 1;
+	alt_32 last = p_min - 1;
 
-	tmp_delay -= IO_DELAY_PER_OPA_TAP;
+	for (p = p_min; p <= p_max; p += WRITE_DESKEW_STRIDE) {
+		if (rw_mgr_mem_calibrate_dm_test (rank_bgn, write_group, new_dqs, p)) {
+			if (first > p_max) {
+				first = p;
+			}
+			last = p;
+		} else if (first <= p_max) {
+			break;
+		}
+	}
 
-	scc_mgr_set_dqdqs_output_phase_all_ranks(g, p - 1);
+	if (first > p_max) {
+		DPRINT(1, "dm_calib: no stride passed; searching every tap");
+		scc_mgr_apply_group_dqs_io_and_oct_out1 (write_group, new_dqs);
+		return 0;
+	}
 
-	for (d = 0; d <= IO_IO_OUT1_DELAY_MAX && tmp_delay < work_mid; d++, tmp_delay += IO_DELAY_PER_DCHAIN_TAP);
+	//USER The window ends in [last, hi) and begins in (lo, first]
+	lo = last;
+	hi = last + WRITE_DESKEW_STRIDE;
+	if (hi > p_max + 1) {
+		hi = p_max + 1;
+	}
+	while (hi - lo > 1) {
+		p = (lo + hi) / 2;
+		if (rw_mgr_mem_calibrate_dm_test (rank_bgn, write_group, new_dqs, p)) {
+			lo = p;
+		} else {
+			hi = p;
+		}
+	}
+	*end = lo;
 
-	scc_mgr_apply_group_all_out_delay_add_all_ranks (g, test_bgn, d - 1);
+	lo = first - WRITE_DESKEW_STRIDE;
+	if (lo < p_min - 1) {
+		lo = p_min - 1;
+	}
+	hi = first;
+	while (hi - lo > 1) {
+		p = (lo + hi) / 2;
+		if (rw_mgr_mem_calibrate_dm_test (rank_bgn, write_group, new_dqs, p)) {
+			hi = p;
+		} else {
+			lo = p;
+		}
+	}
+	*bgn = hi;
 
+	//USER Widen the window while the taps beyond it still pass, as for the DQ pins
+	while (*bgn > p_min && rw_mgr_mem_calibrate_dm_test (rank_bgn, write_group, new_dqs, *bgn - 1)) {
+		--*bgn;
+	}
+	while (*end < p_max && rw_mgr_mem_calibrate_dm_test (rank_bgn, write_group, new_dqs, *end + 1)) {
+		++*end;
+	}
 
+	DPRINT(2, "dm_calib: window [%ld,%ld]", *bgn, *end);
 	return 1;
 }
 
 #endif
 #endif
-#endif
-
-//USER center all windows. do per-bit-deskew to possibly increase size of certain windows
-
-#if NEWVERSION_WRDESKEW
 
 alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_group, alt_u32 test_bgn)
 {
@@ -7247,8 +8420,15 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 #endif
 	alt_32 dq_margin, dqs_margin, dm_margin;
 	alt_u32 stop;
+	deskew_search_t search;
+#if WRITE_DESKEW_STRIDE > 1
+	alt_32 win_bgn[RW_MGR_MEM_DQ_PER_WRITE_DQS];
+	alt_32 win_end[RW_MGR_MEM_DQ_PER_WRITE_DQS];
+	alt_u32 windows;
+#endif
 
 	TRACE_FUNC("%lu %lu", write_group, test_bgn);
+	CAL_PROFILE_DESKEW(1);
 	BFM_STAGE("writes_center");
 
 	ALTERA_ASSERT(write_group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH);
@@ -7259,6 +8439,15 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 
 	select_curr_shadow_reg_using_rank(rank_bgn);
 
+	search.test = rw_mgr_mem_calibrate_writes_center_test;
+	search.rank_bgn = rank_bgn;
+	search.write_group = write_group;
+	search.test_bgn = test_bgn;
+	search.side = 0;
+	search.start_dqs = start_dqs;
+	search.bits = RW_MGR_MEM_DQ_PER_WRITE_DQS;
+	search.correct_mask = param->write_correct_mask;
+
 	//USER per-bit deskew 
 		
 	//USER set the left and right edge of each bit to an illegal value 
@@ -7270,13 +8459,24 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 	}
 	
 	//USER Search for the left edge of the window for each bit
+	//USER With WRITE_DESKEW_STRIDE, find and widen the windows first, then walk them here
+	//USER as the tap-by-tap search would have seen them
+#if WRITE_DESKEW_STRIDE > 1
+	windows = deskew_find_windows (&search, WRITE_DESKEW_STRIDE, IO_IO_OUT1_DELAY_MAX, sticky_bit_chk, win_bgn, win_end);
+	if (windows) {
+		rw_mgr_mem_calibrate_writes_center_widen (&search, IO_IO_OUT1_DELAY_MAX, win_bgn, win_end);
+	}
+#endif
 	for (d = 0; d <= IO_IO_OUT1_DELAY_MAX; d++) {
-		scc_mgr_apply_group_dq_out1_delay (write_group, test_bgn, d);
-
-		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+#if WRITE_DESKEW_STRIDE > 1
+		if (windows) {
+			bit_chk = deskew_window_bits (&search, win_bgn, win_end, d);
+		} else
+#endif
+		bit_chk = rw_mgr_mem_calibrate_writes_center_test (&search, d);
 
 		//USER Stop searching when the read test doesn't pass AND when we've seen a passing read on every bit 
-		stop = !rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 0, PASS_ONE_BIT, &bit_chk, 0);
+		stop = (bit_chk == 0);
 		sticky_bit_chk = sticky_bit_chk | bit_chk;
 		stop = stop && (sticky_bit_chk == param->write_correct_mask);
 		DPRINT(2, "write_center(left): dtap=%lu => " BTFLD_FMT " == " BTFLD_FMT " && %lu [bit_chk=" BTFLD_FMT "]",
@@ -7329,20 +8529,23 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 	}
 	
 	//USER Search for the right edge of the window for each bit 
+	search.side = 1;
+#if WRITE_DESKEW_STRIDE > 1
+	windows = deskew_find_windows (&search, WRITE_DESKEW_STRIDE, IO_IO_OUT1_DELAY_MAX - start_dqs, sticky_bit_chk, win_bgn, win_end);
+	if (windows) {
+		rw_mgr_mem_calibrate_writes_center_widen (&search, IO_IO_OUT1_DELAY_MAX - start_dqs, win_bgn, win_end);
+	}
+#endif
 	for (d = 0; d <= IO_IO_OUT1_DELAY_MAX - start_dqs; d++) {
-		scc_mgr_apply_group_dqs_io_and_oct_out1 (write_group, d + start_dqs);
-
-		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
-		if (QDRII)
-		{
-			rw_mgr_mem_dll_lock_wait();
-		}
+#if WRITE_DESKEW_STRIDE > 1
+		if (windows) {
+			bit_chk = deskew_window_bits (&search, win_bgn, win_end, d);
+		} else
+#endif
+		bit_chk = rw_mgr_mem_calibrate_writes_center_test (&search, d);
 
 		//USER Stop searching when the read test doesn't pass AND when we've seen a passing read on every bit 
-		stop = !rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 0, PASS_ONE_BIT, &bit_chk, 0);
-		if (stop) {
-			recover_mem_device_after_ck_dqs_violation();
-		}
+		stop = (bit_chk == 0);
 		sticky_bit_chk = sticky_bit_chk | bit_chk;
 		stop = stop && (sticky_bit_chk == param->write_correct_mask);
 		
@@ -7406,6 +8609,7 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 		BFM_GBL_SET(dq_write_right_edge[write_group][i],right_edge[i]);
 		if ((left_edge[i] == IO_IO_OUT1_DELAY_MAX + 1) || (right_edge[i] == IO_IO_OUT1_DELAY_MAX + 1)) {
 			set_failing_group_stage(test_bgn + i, CAL_STAGE_WRITES, CAL_SUBSTAGE_WRITES_CENTER);
+			CAL_PROFILE_DESKEW(0);
 			return 0;
 		}
 	}		
@@ -7653,81 +8857,89 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 	alt_32 end_best = IO_IO_OUT1_DELAY_MAX + 1;
 	alt_32 win_best = 0;
 	
-	//USER Search for the/part of the window with DM shift
-	for (d = IO_IO_OUT1_DELAY_MAX; d >= 0; d-=DELTA_D) {
-		scc_mgr_apply_group_dm_out1_delay (write_group, d);
-		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+#if WRITE_DESKEW_STRIDE > 1
+	if (rw_mgr_mem_calibrate_dm_window (rank_bgn, write_group, new_dqs, &bgn_best, &end_best)) {
+		win_best = end_best - bgn_best + 1;
+	} else
+#endif
+	{
+		//USER Search for the/part of the window with DM shift
+		for (d = IO_IO_OUT1_DELAY_MAX; d >= 0; d-=DELTA_D) {
+			scc_mgr_apply_group_dm_out1_delay (write_group, d);
+			IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
 
-		if (rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 1, PASS_ALL_BITS, &bit_chk, 0)) {
+			if (rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 1, PASS_ALL_BITS, &bit_chk, 0)) {
 			
-			//USE Set current end of the window
-			end_curr = -d;
-			//USER If a starting edge of our window has not been seen this is our current start of the DM window
-			if(bgn_curr == IO_IO_OUT1_DELAY_MAX + 1){
-				bgn_curr = -d;
-			}
+				//USE Set current end of the window
+				end_curr = -d;
+				//USER If a starting edge of our window has not been seen this is our current start of the DM window
+				if(bgn_curr == IO_IO_OUT1_DELAY_MAX + 1){
+					bgn_curr = -d;
+				}
 
-			//USER If current window is bigger than best seen. Set best seen to be current window 
-			if((end_curr-bgn_curr+1) > win_best ){
-				win_best = end_curr-bgn_curr+1;
-				bgn_best = bgn_curr;
-				end_best = end_curr;
-			}
-		} else {
-			//USER We just saw a failing test. Reset temp edge
-			bgn_curr=IO_IO_OUT1_DELAY_MAX + 1;
-			end_curr=IO_IO_OUT1_DELAY_MAX + 1;
-			}
+				//USER If current window is bigger than best seen. Set best seen to be current window 
+				if((end_curr-bgn_curr+1) > win_best ){
+					win_best = end_curr-bgn_curr+1;
+					bgn_best = bgn_curr;
+					end_best = end_curr;
+				}
+			} else {
+				//USER We just saw a failing test. Reset temp edge
+				bgn_curr=IO_IO_OUT1_DELAY_MAX + 1;
+				end_curr=IO_IO_OUT1_DELAY_MAX + 1;
+				}
 		
 	
-		}
+			}
 
 	
-	//USER Reset DM delay chains to 0
-	scc_mgr_apply_group_dm_out1_delay (write_group, 0);
+		//USER Reset DM delay chains to 0
+		scc_mgr_apply_group_dm_out1_delay (write_group, 0);
 
-	//USER Check to see if the current window nudges up aganist 0 delay. If so we need to continue the search by shifting DQS otherwise DQS search begins as a new search
-	if(end_curr!=0) {
-		bgn_curr=IO_IO_OUT1_DELAY_MAX + 1;
-		end_curr=IO_IO_OUT1_DELAY_MAX + 1;
-	}
+		//USER Check to see if the current window nudges up aganist 0 delay. If so we need to continue the search by shifting DQS otherwise DQS search begins as a new search
+		if(end_curr!=0) {
+			bgn_curr=IO_IO_OUT1_DELAY_MAX + 1;
+			end_curr=IO_IO_OUT1_DELAY_MAX + 1;
+		}
 		
-	//USER Search for the/part of the window with DQS shifts
-	for (d = 0; d <= IO_IO_OUT1_DELAY_MAX - new_dqs; d+=DELTA_D) {
-		// Note: This only shifts DQS, so are we limiting ourselve to
-		// width of DQ unnecessarily
-		scc_mgr_apply_group_dqs_io_and_oct_out1 (write_group, d + new_dqs);
+		//USER Search for the/part of the window with DQS shifts
+		for (d = 0; d <= IO_IO_OUT1_DELAY_MAX - new_dqs; d+=DELTA_D) {
+			// Note: This only shifts DQS, so are we limiting ourselve to
+			// width of DQ unnecessarily
+			scc_mgr_apply_group_dqs_io_and_oct_out1 (write_group, d + new_dqs);
 
-		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+			IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
 
-		if (rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 1, PASS_ALL_BITS, &bit_chk, 0)) {
+			if (rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 1, PASS_ALL_BITS, &bit_chk, 0)) {
 			
-			//USE Set current end of the window
-			end_curr = d;
-			//USER If a beginning edge of our window has not been seen this is our current begin of the DM window
-			if(bgn_curr == IO_IO_OUT1_DELAY_MAX + 1){
-				bgn_curr = d;
-			}
+				//USE Set current end of the window
+				end_curr = d;
+				//USER If a beginning edge of our window has not been seen this is our current begin of the DM window
+				if(bgn_curr == IO_IO_OUT1_DELAY_MAX + 1){
+					bgn_curr = d;
+				}
 				
-			//USER If current window is bigger than best seen. Set best seen to be current window
-			if((end_curr-bgn_curr+1) > win_best){
-				win_best = end_curr-bgn_curr+1;
-				bgn_best = bgn_curr;
-				end_best = end_curr;
-			}
-		} else {
-			//USER We just saw a failing test. Reset temp edge
-			recover_mem_device_after_ck_dqs_violation();
-			bgn_curr = IO_IO_OUT1_DELAY_MAX + 1;
-			end_curr = IO_IO_OUT1_DELAY_MAX + 1;
-			
-			//USER Early exit optimization: if ther remaining delay chain space is less than already seen largest window we can exit
-			if((win_best-1) > (IO_IO_OUT1_DELAY_MAX - new_dqs - d)){				
-					break;
+				//USER If current window is bigger than best seen. Set best seen to be current window
+				if((end_curr-bgn_curr+1) > win_best){
+					win_best = end_curr-bgn_curr+1;
+					bgn_best = bgn_curr;
+					end_best = end_curr;
 				}
+			} else {
+				//USER We just saw a failing test. Reset temp edge
+				recover_mem_device_after_ck_dqs_violation();
+				bgn_curr = IO_IO_OUT1_DELAY_MAX + 1;
+				end_curr = IO_IO_OUT1_DELAY_MAX + 1;
+			
+				//USER Early exit optimization: if ther remaining delay chain space is less than already seen largest window we can exit
+				if((win_best-1) > (IO_IO_OUT1_DELAY_MAX - new_dqs - d)){				
+						break;
+					}
 		
-				}
-				}
+					}
+					}
+
+	}
 
 	//USER assign left and right edge for cal and reporting;
 	left_edge[0] = -1*bgn_best;
@@ -7940,6 +9152,7 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 
 	//USER Do not remove this line as it makes sure all of our decisions have been applied
 	IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);	
+	CAL_PROFILE_DESKEW(0);
 	return (dq_margin >= 0) && (dqs_margin >= 0) && (dm_margin >= 0);
 }
 
@@ -9144,6 +10357,274 @@ void print_report(alt_u32 pass)
 }
 #endif //RUNTIME_CAL_REPORT
 
+#if ENABLE_CAL_CACHE
+
+// Calibration cache
+//
+// When a full calibration passes, the settings it chose for each group
+// are kept in cal_cache, with a checksum, and copied to CAL_CACHE_HANDOFF
+// if that is defined.  u-boot can save them to QSPI or SD and put them
+// back there before the next boot.  mem_calibrate then restores them
+// instead of calibrating, as long as the checksum holds and every group
+// still writes and reads with its DQS delays CAL_CACHE_GUARD taps either
+// side of the restored ones.  If not, it calibrates as usual, starting
+// from the cache's cal_hints when ENABLE_CAL_HINTS is set.
+
+cal_cache_t cal_cache;
+alt_u32 cal_cache_state;
+
+//USER CRC-32 of the words after the checksum
+static alt_u32 cal_cache_checksum (void)
+{
+	alt_u32 *p = &cal_cache.read_lat;
+	alt_u32 *end = (alt_u32 *) (&cal_cache + 1);
+	alt_u32 crc = 0xffffffff;
+	alt_u32 i;
+
+	for (; p < end; p++) {
+		crc ^= *p;
+		for (i = 0; i < 32; i++) {
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+		}
+	}
+	return ~crc;
+}
+
+//USER Keep the settings a write group calibrated to, from the SCC manager
+static void cal_cache_save_group (alt_u32 write_group, alt_u32 write_test_bgn)
+{
+	alt_u32 read_group, read_test_bgn, i;
+
+	IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, write_group);
+
+	for (read_group = write_group * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH, read_test_bgn = 0;
+	     read_group < (write_group + 1) * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH;
+	     read_group++, read_test_bgn += RW_MGR_MEM_DQ_PER_READ_DQS) {
+		cal_cache.vfifo[read_group] = gbl->vfifo[read_group];
+		cal_cache.dqs_en_phase[read_group] = READ_SCC_DQS_EN_PHASE(read_group);
+		cal_cache.dqs_en_delay[read_group] = READ_SCC_DQS_EN_DELAY(read_group);
+		cal_cache.dqs_in_delay[read_group] = READ_SCC_DQS_IN_DELAY(read_group);
+		for (i = 0; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++) {
+			cal_cache.dq_in_delay[write_test_bgn + read_test_bgn + i] = READ_SCC_DQ_IN_DELAY(read_test_bgn + i);
+		}
+	}
+
+	for (i = 0; i < RW_MGR_MEM_DQ_PER_WRITE_DQS; i++) {
+		cal_cache.dq_out1_delay[write_test_bgn + i] = READ_SCC_DQ_OUT1_DELAY(i);
+	}
+	for (i = 0; i < RW_MGR_NUM_DM_PER_WRITE_GROUP; i++) {
+		cal_cache.dm_out1_delay[write_group][i] = READ_SCC_DM_IO_OUT1_DELAY(i);
+	}
+	cal_cache.dqs_out1_delay[write_group] = READ_SCC_DQS_IO_OUT1_DELAY();
+	cal_cache.oct_out1_delay[write_group] = READ_SCC_OCT_OUT1_DELAY(write_group);
+	cal_cache.dqdqs_out_phase[write_group] = READ_SCC_DQDQS_OUT_PHASE(write_group);
+}
+
+//USER Seal the cache once every group is saved and the LFIFO calibrated
+static void cal_cache_finish (void)
+{
+	cal_cache.size = sizeof (cal_cache);
+	cal_cache.read_lat = gbl->curr_read_lat;
+	cal_cache.fom_in = gbl->fom_in;
+	cal_cache.fom_out = gbl->fom_out;
+#if ENABLE_CAL_HINTS
+	cal_cache.hints = cal_hints;
+#endif
+	cal_cache.checksum = cal_cache_checksum ();
+	cal_cache.magic = CAL_CACHE_MAGIC;
+
+#ifdef CAL_CACHE_HANDOFF
+	{
+		alt_u32 *src = (alt_u32 *) &cal_cache;
+		volatile alt_u32 *dst = (volatile alt_u32 *) (CAL_CACHE_HANDOFF);
+		alt_u32 i;
+
+		for (i = 0; i < sizeof (cal_cache) / sizeof (alt_u32); i++) {
+			dst[i] = src[i];
+		}
+	}
+#endif
+}
+
+//USER Load a write group's cached settings into the SCC manager and the VFIFO
+static void cal_cache_load_group (alt_u32 write_group, alt_u32 write_test_bgn)
+{
+	alt_u32 read_group, read_test_bgn, i;
+	alt_u32 v = 0;
+
+	IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, write_group);
+	scc_mgr_zero_group (write_group, write_test_bgn, 0);
+
+	for (read_group = write_group * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH, read_test_bgn = 0;
+	     read_group < (write_group + 1) * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH;
+	     read_group++, read_test_bgn += RW_MGR_MEM_DQ_PER_READ_DQS) {
+		while (gbl->vfifo[read_group] != cal_cache.vfifo[read_group]) {
+			rw_mgr_incr_vfifo(read_group, &v);
+		}
+		scc_mgr_set_dqs_en_phase(read_group, cal_cache.dqs_en_phase[read_group]);
+		scc_mgr_set_dqs_en_delay(read_group, cal_cache.dqs_en_delay[read_group]);
+		scc_mgr_set_dqs_bus_in_delay(read_group, cal_cache.dqs_in_delay[read_group]);
+		scc_mgr_load_dqs (read_group);
+		for (i = 0; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++) {
+			scc_mgr_set_dq_in_delay(write_group, read_test_bgn + i, cal_cache.dq_in_delay[write_test_bgn + read_test_bgn + i]);
+			scc_mgr_load_dq (read_test_bgn + i);
+		}
+	}
+
+	for (i = 0; i < RW_MGR_MEM_DQ_PER_WRITE_DQS; i++) {
+		scc_mgr_set_dq_out1_delay(write_group, i, cal_cache.dq_out1_delay[write_test_bgn + i]);
+		scc_mgr_load_dq (i);
+	}
+	for (i = 0; i < RW_MGR_NUM_DM_PER_WRITE_GROUP; i++) {
+		scc_mgr_set_dm_out1_delay(write_group, i, cal_cache.dm_out1_delay[write_group][i]);
+		scc_mgr_load_dm (i);
+	}
+	scc_mgr_set_dqdqs_output_phase(write_group, cal_cache.dqdqs_out_phase[write_group]);
+	scc_mgr_set_dqs_out1_delay(write_group, cal_cache.dqs_out1_delay[write_group]);
+	scc_mgr_load_dqs_io ();
+	scc_mgr_set_oct_out1_delay(write_group, cal_cache.oct_out1_delay[write_group]);
+	scc_mgr_load_dqs_for_write_group (write_group);
+
+	IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+}
+
+//USER Writes to a restored write group must pass every bit, with DM, and without it
+//USER with DQS out CAL_CACHE_GUARD taps either side of where it was restored
+static alt_u32 cal_cache_check_writes (alt_u32 write_group)
+{
+	alt_32 d, dqs = cal_cache.dqs_out1_delay[write_group];
+	alt_u32 pass = 1;
+	t_btfld bit_chk;
+
+	if (DDRX && !rw_mgr_mem_calibrate_write_test (0, write_group, 1, PASS_ALL_BITS, &bit_chk, 1)) {
+		return 0;
+	}
+
+	for (d = -CAL_CACHE_GUARD; d <= CAL_CACHE_GUARD && pass; d += CAL_CACHE_GUARD ? CAL_CACHE_GUARD : 1) {
+		if (dqs + d < 0 || dqs + d > IO_IO_OUT1_DELAY_MAX) {
+			continue;
+		}
+		scc_mgr_apply_group_dqs_io_and_oct_out1 (write_group, dqs + d);
+		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+		if (!rw_mgr_mem_calibrate_write_test (0, write_group, 0, PASS_ALL_BITS, &bit_chk, 1)) {
+			DPRINT(1, "cal_cache: write group %lu fails at dqs out %ld", write_group, dqs + d);
+			if (d != 0) {
+				recover_mem_device_after_ck_dqs_violation();
+			}
+			pass = 0;
+		}
+	}
+
+	scc_mgr_apply_group_dqs_io_and_oct_out1 (write_group, dqs);
+	IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+	return pass;
+}
+
+//USER Reads from a restored read group, of the patterns already written, must pass
+//USER every bit with DQS in CAL_CACHE_GUARD taps either side of where it was restored
+static alt_u32 cal_cache_check_reads (alt_u32 read_group)
+{
+	alt_32 d, dqs = cal_cache.dqs_in_delay[read_group];
+	alt_u32 pass = 1;
+	t_btfld bit_chk;
+
+	IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, read_group * RW_MGR_MEM_IF_WRITE_DQS_WIDTH / RW_MGR_MEM_IF_READ_DQS_WIDTH);
+
+	for (d = -CAL_CACHE_GUARD; d <= CAL_CACHE_GUARD && pass; d += CAL_CACHE_GUARD ? CAL_CACHE_GUARD : 1) {
+		if (dqs + d < 0 || dqs + d > IO_DQS_IN_DELAY_MAX) {
+			continue;
+		}
+		scc_mgr_set_dqs_bus_in_delay(read_group, dqs + d);
+		scc_mgr_load_dqs (read_group);
+		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+		if (!rw_mgr_mem_calibrate_read_test_all_ranks (read_group, NUM_READ_TESTS, PASS_ALL_BITS, &bit_chk, 0)) {
+			DPRINT(1, "cal_cache: read group %lu fails at dqs in %ld", read_group, dqs + d);
+			pass = 0;
+		}
+	}
+
+	scc_mgr_set_dqs_bus_in_delay(read_group, dqs);
+	scc_mgr_load_dqs (read_group);
+	IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+	return pass;
+}
+
+//USER Restore the settings of the last full calibration, if cal_cache holds them,
+//USER and check them.  Returns 0 if calibration has to run instead.
+static alt_u32 cal_cache_restore (void)
+{
+	alt_u32 write_group, write_test_bgn, read_group;
+
+	cal_cache_state = CAL_CACHE_NONE;
+
+#ifdef CAL_CACHE_HANDOFF
+	{
+		volatile alt_u32 *src = (volatile alt_u32 *) (CAL_CACHE_HANDOFF);
+		alt_u32 *dst = (alt_u32 *) &cal_cache;
+		alt_u32 i;
+
+		for (i = 0; i < sizeof (cal_cache) / sizeof (alt_u32); i++) {
+			dst[i] = src[i];
+		}
+	}
+#endif
+
+	if (cal_cache.magic != CAL_CACHE_MAGIC || cal_cache.size != sizeof (cal_cache) ||
+	    cal_cache.checksum != cal_cache_checksum ()) {
+		DPRINT(1, "cal_cache: no valid settings to restore");
+		cal_cache.magic = 0;
+		return 0;
+	}
+
+#if ENABLE_CAL_HINTS
+	//USER Where the last calibration found its edges is worth knowing even if its
+	//USER settings no longer pass
+	cal_hints = cal_cache.hints;
+#endif
+
+	reg_file_set_stage(CAL_STAGE_CAL_SKIPPED);
+
+	scc_mgr_zero_all ();
+	for (write_group = 0, write_test_bgn = 0; write_group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH; write_group++, write_test_bgn += RW_MGR_MEM_DQ_PER_WRITE_DQS) {
+		reg_file_set_group(write_group);
+		cal_cache_load_group (write_group, write_test_bgn);
+	}
+	IOWR_32DIRECT (PHY_MGR_PHY_RLAT, 0, cal_cache.read_lat);
+
+	for (write_group = 0; write_group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH; write_group++) {
+		reg_file_set_group(write_group);
+		if (!cal_cache_check_writes (write_group)) {
+			break;
+		}
+	}
+
+	if (write_group == RW_MGR_MEM_IF_WRITE_DQS_WIDTH) {
+		rw_mgr_mem_calibrate_read_load_patterns_all_ranks ();
+		for (read_group = 0; read_group < RW_MGR_MEM_IF_READ_DQS_WIDTH; read_group++) {
+			reg_file_set_group(read_group);
+			if (!cal_cache_check_reads (read_group)) {
+				break;
+			}
+		}
+		if (read_group == RW_MGR_MEM_IF_READ_DQS_WIDTH) {
+			gbl->curr_read_lat = cal_cache.read_lat;
+			gbl->fom_in = cal_cache.fom_in;
+			gbl->fom_out = cal_cache.fom_out;
+			cal_cache_state = CAL_CACHE_RESTORED;
+			DPRINT(1, "cal_cache: restored");
+			return 1;
+		}
+	}
+
+	//USER Calibrate from where mem_config left the read latency
+	IOWR_32DIRECT (PHY_MGR_PHY_RLAT, 0, gbl->curr_read_lat);
+	cal_cache.magic = 0;
+	cal_cache_state = CAL_CACHE_REJECTED;
+	return 0;
+}
+
+#endif
+
 //USER Memory calibration entry point
  
 alt_u32 mem_calibrate (void)
@@ -9189,6 +10670,10 @@ alt_u32 mem_calibrate (void)
 		//USER Set VFIFO and LFIFO to instant-on settings in skip calibration mode 
 
 		mem_skip_calibrate ();
+#if ENABLE_CAL_CACHE
+	} else if (cal_cache_restore ()) {
+		//USER Restored the settings of the last calibration
+#endif
 	} else {
 		for (i = 0; i < NUM_CALIB_REPEAT; i++) {
 		
@@ -9205,6 +10690,12 @@ alt_u32 mem_calibrate (void)
 
 			run_groups = ~param->skip_groups;
 
+#if ENABLE_PARALLEL_GROUPS
+			if (!((STATIC_CALIB_STEPS) & CALIB_SKIP_VFIFO)) {
+				rw_mgr_mem_calibrate_dqs_en_all_groups (run_groups);
+			}
+#endif
+
 			for (write_group = 0, write_test_bgn = 0; write_group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH; write_group++, write_test_bgn += RW_MGR_MEM_DQ_PER_WRITE_DQS)
 			{
 				// Initialized the group failure
@@ -9331,6 +10822,10 @@ alt_u32 mem_calibrate (void)
 					print_group_settings(write_group, write_test_bgn);
 #endif
 
+#if ENABLE_CAL_CACHE
+					cal_cache_save_group (write_group, write_test_bgn);
+#endif
+
 #if STATIC_IN_RTL_SIM
 #if ENABLE_TCL_DEBUG && BFM_MODE
 	tclrpt_populate_fake_margin_data();
@@ -9410,6 +10905,12 @@ alt_u32 mem_calibrate (void)
 					if (!rw_mgr_mem_calibrate_lfifo ()) {
 						return 0;
 					}
+#if ENABLE_CAL_HINTS
+					cal_hints.valid = 1;
+#endif
+#if ENABLE_CAL_CACHE
+					cal_cache_finish ();
+#endif
 				}
 			}
 		}
@@ -9664,9 +11165,48 @@ alt_u32 run_mem_calibrate(void) {
 }
 
 #if HCX_COMPAT_MODE || ENABLE_INST_ROM_WRITE
+#if ENABLE_ROM_SIGNATURE
+//USER The signature of the ROM images: their sizes and words, each
+//USER rotated into the one before, starting from REG_FILE_INIT_SEQ_SIGNATURE
+//USER so that another sequencer's images do not share it.  Unlike a CRC,
+//USER it takes less time than loading them.  hc_initialize_rom_data
+//USER leaves it in REG_FILE_ROM_SIGNATURE once the ROMs are loaded, and
+//USER loads them again only if it is gone.  This relies on the register
+//USER file losing its contents whenever the RW manager loses its ROMs;
+//USER both are reset with the PHY.
+#define ROM_SIGNATURE_ADD(sig, word)	((((sig) << 5) | ((sig) >> 27)) ^ (word))
+
+static alt_u32 rom_signature (void)
+{
+	alt_u32 sig = REG_FILE_INIT_SEQ_SIGNATURE;
+	alt_u32 i;
+
+	sig = ROM_SIGNATURE_ADD (sig, inst_rom_init_size);
+	for (i = 0; i < inst_rom_init_size; i++) {
+		sig = ROM_SIGNATURE_ADD (sig, inst_rom_init[i]);
+	}
+	sig = ROM_SIGNATURE_ADD (sig, ac_rom_init_size);
+	for (i = 0; i < ac_rom_init_size; i++) {
+		sig = ROM_SIGNATURE_ADD (sig, ac_rom_init[i]);
+	}
+	return sig;
+}
+#endif
+
 void hc_initialize_rom_data(void)
 {
 	alt_u32 i;
+#if ENABLE_ROM_SIGNATURE
+	alt_u32 signature = rom_signature ();
+
+	//USER A register file cleared at reset never holds the signature
+	if (signature != 0 && IORD_32DIRECT (REG_FILE_ROM_SIGNATURE, 0) == signature) {
+		return;
+	}
+
+	//USER Until both ROMs are loaded, neither is known to hold its image
+	IOWR_32DIRECT (REG_FILE_ROM_SIGNATURE, 0, 0);
+#endif
 
 	for(i = 0; i < inst_rom_init_size; i++)
 	{
@@ -9679,6 +11219,10 @@ void hc_initialize_rom_data(void)
 		alt_u32 data = ac_rom_init[i];
 		IOWR_32DIRECT (RW_MGR_AC_ROM_WRITE, (i << 2), data);
 	}
+
+#if ENABLE_ROM_SIGNATURE
+	IOWR_32DIRECT (REG_FILE_ROM_SIGNATURE, 0, signature);
+#endif
 }
 #endif
 
@@ -10534,6 +12078,20 @@ int main(void)
 	param = &my_param;
 	gbl = &my_gbl;
 
+#if ENABLE_CAL_CACHE || ENABLE_CAL_HINTS
+	// The PHY comes out of reset with every VFIFO at 0
+	for (i = 0; i < RW_MGR_MEM_IF_READ_DQS_WIDTH; i++) {
+		gbl->vfifo[i] = 0;
+	}
+#endif
+
+#if ENABLE_CAL_PROFILE
+	cal_profile_start();
+#endif
+#if ENABLE_SCC_SHADOW
+	scc_shadow_start();
+#endif
+
 	// Initialize the debug mode flags
 	gbl->phy_debug_mode_flags = 0;
 	// Set the calibration enabled by default
@@ -10705,6 +12263,13 @@ int main(void)
 	}
 #endif
 
+#if ENABLE_SCC_SHADOW
+	scc_shadow_finish();
+#endif
+#if ENABLE_CAL_PROFILE
+	cal_profile_finish(pass);
+#endif
+
 #if ENABLE_PRINTF_LOG
 	IPRINT("Calibration complete");
 	// Send the end of transmission character
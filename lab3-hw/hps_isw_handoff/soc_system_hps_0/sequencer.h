@@ -127,9 +127,54 @@ extern void err_report_internal_error (const char* description, const char* modu
 #define NUM_WRITE_TESTS			15
 #define NUM_WRITE_PB_TESTS		31
 
+/* Write deskew and DM centering step their delay chains this many taps
+   at a time, bisect to the edges in between, then test again just beyond
+   each edge and widen any window that still passes there; 1 tests every
+   tap */
+#ifndef WRITE_DESKEW_STRIDE
+#define WRITE_DESKEW_STRIDE		1
+#endif
+
+/* Keep the settings of a full calibration in cal_cache and, on the next
+   boot, restore and check them instead of calibrating; see mem_calibrate */
+#ifndef ENABLE_CAL_CACHE
+#define ENABLE_CAL_CACHE		0
+#endif
+
+/* Start the DQS enable and LFIFO searches from where they ended last time,
+   in cal_hints, rather than from zero */
+#ifndef ENABLE_CAL_HINTS
+#define ENABLE_CAL_HINTS		0
+#endif
+
+/* Find the DQS enable settings of all read groups before calibrating the
+   first, stepping their delay sweeps together and testing all groups at
+   once while they are expected to pass */
+#ifndef ENABLE_PARALLEL_GROUPS
+#define ENABLE_PARALLEL_GROUPS		0
+#endif
+
+/* Test each setting of the DQS enable and LFIFO sweeps, which pass until
+   they reach an edge, once rather than num_tries times; the last setting
+   before the edge gets num_tries, backing off while it fails them */
+#ifndef ENABLE_ADAPTIVE_TRIES
+#define ENABLE_ADAPTIVE_TRIES		0
+#endif
+
+/* Leave the RW manager's instruction and AC ROMs alone if the register
+   file says they already hold this sequencer's images, as after a
+   recalibration or a warm reset; see hc_initialize_rom_data */
+#ifndef ENABLE_ROM_SIGNATURE
+#define ENABLE_ROM_SIGNATURE		0
+#endif
+
 #define PASS_ALL_BITS			1
 #define PASS_ONE_BIT			0
 
+/* all_groups of rw_mgr_mem_calibrate_read_test: a read test of all groups
+   with as many reads of each as a test of one */
+#define READ_TEST_ALL_GROUPS_FULL	2
+
 /* calibration stages */
 
 #define CAL_STAGE_NIL			0
@@ -197,6 +242,7 @@ extern void err_report_internal_error (const char* description, const char* modu
 #define REG_FILE_FAILING_STAGE          (BASE_REG_FILE + 0x0010)
 #define REG_FILE_DEBUG1                 (BASE_REG_FILE + 0x0014)
 #define REG_FILE_DEBUG2                 (BASE_REG_FILE + 0x0018)
+#define REG_FILE_ROM_SIGNATURE          (BASE_REG_FILE + 0x0038)
 
 #if TRACKING_WATCH_TEST || TRACKING_ERROR_TEST
 #define REG_FILE_TRK_SAMPLE_CHECK	(BASE_REG_FILE + 0x003C)
@@ -608,11 +654,125 @@ typedef struct gbl_type {
 	alt_u32 rw_wl_nop_cycles_per_group[RW_MGR_MEM_IF_WRITE_DQS_WIDTH];
 #endif
 	alt_u32 rw_wl_nop_cycles;
+
+#if ENABLE_CAL_CACHE || ENABLE_CAL_HINTS
+	/* VFIFO increments per read group since reset, mod VFIFO_SIZE */
+	alt_u32 vfifo[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+#endif
 } gbl_t;
 
+#if ENABLE_CAL_PROFILE
+
+/* calibration profile: time and register accesses per stage and group */
+
+#define CAL_PROFILE_MAGIC		0x46525043	/* "CPRF" */
+#define CAL_PROFILE_STAGES		(CAL_STAGE_VFIFO_AFTER_WRITES + 1)
+
+#define CAL_PROFILE_SCC			0
+#define CAL_PROFILE_RW			1
+#define CAL_PROFILE_PHY			2
+#define CAL_PROFILE_REG_FILE		3
+#define CAL_PROFILE_OTHER		4	/* data manager and controller */
+#define CAL_PROFILE_MGRS		5
+
+typedef struct cal_profile_count_type {
+	alt_u32 cycles;
+	alt_u32 reads[CAL_PROFILE_MGRS];
+	alt_u32 writes[CAL_PROFILE_MGRS];
+	alt_u32 tests;			/* read and write tests */
+	alt_u32 retests;		/* of those, confirming an edge */
+	alt_u32 deskew;			/* of those, in read or write deskew */
+	alt_u32 saved;			/* SCC accesses left to the shadow */
+} cal_profile_count_t;
+
+typedef struct cal_profile_type {
+	alt_u32 magic;
+	alt_u32 size;			/* sizeof (cal_profile_t) */
+	alt_u32 pass;
+	cal_profile_count_t total;
+	cal_profile_count_t stage[CAL_PROFILE_STAGES];
+	cal_profile_count_t group[CAL_PROFILE_STAGES][MAX_DQS];
+} cal_profile_t;
+
+#endif
+
+#if ENABLE_CAL_HINTS
+
+/* calibration hints: where the searches found their edges last time.
+   CAL_HINTS_DEFAULT, if defined, is an initializer with a board's usual
+   values; otherwise they come from an earlier calibration, in this boot or,
+   through cal_cache, the last one */
+
+typedef struct cal_hints_type {
+	alt_u32 valid;
+	alt_u32 read_lat;		/* PHY_RLAT that first failed */
+	/* VFIFO of the first DQS enable that read correctly */
+	alt_u32 vfifo[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+	/* DQS enable delay that failed after the last working phase */
+	alt_u32 dqs_en_delay_end[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+} cal_hints_t;
+
+#endif
+
+#if ENABLE_CAL_CACHE
+
+/* calibration cache: the settings of the last full calibration, restored
+   and checked on the next boot instead of calibrating again */
+
+#if NUM_SHADOW_REGS > 1
+#error "ENABLE_CAL_CACHE keeps one set of settings and needs NUM_SHADOW_REGS == 1"
+#endif
+
+#define CAL_CACHE_MAGIC			0x48434C43	/* "CLCH" */
+
+/* Taps the DQS in and out delays move either side of the restored ones
+   while checking them; each must still pass every bit */
+#ifndef CAL_CACHE_GUARD
+#define CAL_CACHE_GUARD			2
+#endif
+
+/* cal_cache_state */
+#define CAL_CACHE_NONE			0	/* no valid cache; calibrated */
+#define CAL_CACHE_RESTORED		1	/* restored and checked */
+#define CAL_CACHE_REJECTED		2	/* check failed; calibrated */
+
+typedef struct cal_cache_type {
+	alt_u32 magic;
+	alt_u32 size;			/* sizeof (cal_cache_t) */
+	alt_u32 checksum;		/* of the words after it */
+	alt_u32 read_lat;
+	alt_u32 fom_in;
+	alt_u32 fom_out;
+	alt_u32 vfifo[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+	alt_u32 dqs_en_phase[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+	alt_u32 dqs_en_delay[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+	alt_u32 dqs_in_delay[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+	alt_u32 dq_in_delay[RW_MGR_MEM_DATA_WIDTH];
+	alt_u32 dq_out1_delay[RW_MGR_MEM_DATA_WIDTH];
+	alt_u32 dm_out1_delay[RW_MGR_MEM_IF_WRITE_DQS_WIDTH][RW_MGR_NUM_DM_PER_WRITE_GROUP];
+	alt_u32 dqs_out1_delay[RW_MGR_MEM_IF_WRITE_DQS_WIDTH];
+	alt_u32 oct_out1_delay[RW_MGR_MEM_IF_WRITE_DQS_WIDTH];
+	alt_u32 dqdqs_out_phase[RW_MGR_MEM_IF_WRITE_DQS_WIDTH];
+#if ENABLE_CAL_HINTS
+	cal_hints_t hints;
+#endif
+} cal_cache_t;
+
+#endif
+
 // External global variables
 extern gbl_t *gbl;
 extern param_t *param;
+#if ENABLE_CAL_PROFILE
+extern cal_profile_t cal_profile;
+#endif
+#if ENABLE_CAL_HINTS
+extern cal_hints_t cal_hints;
+#endif
+#if ENABLE_CAL_CACHE
+extern cal_cache_t cal_cache;
+extern alt_u32 cal_cache_state;
+#endif
 
 // External functions
 alt_u32 rw_mgr_mem_calibrate_full_test (alt_u32 min_correct, t_btfld *bit_chk, alt_u32 test_dm);
@@ -0,0 +1,486 @@
+/*
+ * Behavioural model of the hard memory PHY for the host build of
+ * sequencer.c
+ */
+
+#include <string.h>
+#include "sdram.h"
+#include "sequencer_auto.h"
+#include "phy_model.h"
+
+/* APB windows of the managers, from sdram.h */
+#define SCC_BASE      SDR_PHYGRP_SCCGRP_ADDRESS
+#define PHY_BASE      SDR_PHYGRP_PHYMGRGRP_ADDRESS
+#define RW_BASE       SDR_PHYGRP_RWMGRGRP_ADDRESS
+#define DATA_BASE     SDR_PHYGRP_DATAMGRGRP_ADDRESS
+#define REG_FILE_BASE SDR_PHYGRP_REGFILEGRP_ADDRESS
+#define MMR_BASE      SDR_CTRLGRP_ADDRESS
+
+/* SCC manager */
+#define SCC_GROUP_COUNTER 0x000
+#define SCC_DQS_IN_DELAY  0x100
+#define SCC_DQS_EN_PHASE  0x200
+#define SCC_DQS_EN_DELAY  0x300
+#define SCC_IO_OUT1_DELAY 0x700
+#define SCC_IO_IN_DELAY   0x900
+#define SCC_DQS_ENA       0xE00
+#define SCC_DQS_IO_ENA    0xE04
+#define SCC_DQ_ENA        0xE08
+#define SCC_DM_ENA        0xE0C
+#define SCC_UPD           0xE20
+
+/* RW manager */
+#define RW_RUN_SINGLE_GROUP 0x0000
+#define RW_RUN_ALL_GROUPS   0x0400
+#define RW_LOAD_CNTR        0x0800
+#define RW_WINDOW           0x2000
+
+/* PHY manager: bit 6 of the APB address selects the CSRs */
+#define PHY_CSR             0x40
+#define PHY_CMD_INC_VFIFO   0x04
+#define PHY_CSR_RLAT        (PHY_CSR + 0x00)
+#define PHY_MAX_RLAT_WIDTH  0x00
+#define PHY_CALIB_VFIFO     0x10
+#define PHY_CALIB_LFIFO     0x14
+#define PHY_MEM_T_WL        0x1c
+#define PHY_MEM_T_RL        0x20
+
+/* Data manager */
+#define DATA_MEM_T_WL       0x04
+#define DATA_MEM_T_ADD      0x08
+#define DATA_MEM_T_RL       0x0C
+
+#define ALL_ITEMS           0xff
+
+/* The DQS enable window repeats around the VFIFO */
+#define PTAP_PS   IO_DELAY_PER_OPA_TAP
+#define DTAP_PS   IO_DELAY_PER_DQS_EN_DCHAIN_TAP
+#define CYCLE_PS  (IO_DLL_CHAIN_LENGTH * PTAP_PS)
+#define RING_PS   (READ_VALID_FIFO_SIZE * CYCLE_PS)
+#define CLOCK_PS  (1000000 / AFI_CLK_FREQ)
+
+enum test { TEST_NONE, TEST_READ, TEST_WRITE, TEST_WRITE_DM };
+
+static struct {
+  pm_config_t c;
+  pm_stats_t stats;
+  unsigned int rand;
+
+  /* Eyes: first and last passing value of each pin */
+  int rd_lo[PM_GROUPS][PM_DQ], rd_hi[PM_GROUPS][PM_DQ];
+  int wr_lo[PM_GROUPS][PM_PINS], wr_hi[PM_GROUPS][PM_PINS];
+  int en_lo[PM_GROUPS];
+
+  /* SCC: staging registers, scan chains, and what is in effect */
+  unsigned long scc[0x1000 / 4];
+  int group;
+  unsigned long pin_out1[PM_GROUPS][PM_PINS], pin_in[PM_GROUPS][PM_PINS];
+  pm_group_t chain[PM_GROUPS], active[PM_GROUPS];
+  int vfifo[PM_GROUPS];
+
+  unsigned long rw_cntr[4];
+  unsigned long rw_result;
+  unsigned long phy[0x80 / 4];
+  unsigned long data[0x800 / 4];
+  unsigned long reg_file[0x800 / 4];
+  unsigned long rw_rom[(RW_WINDOW - RW_ROM_INST) / 4];
+  unsigned long mmr[0x1000 / 4];
+} pm;
+
+static unsigned int next_rand(void) {
+  pm.rand ^= pm.rand << 13;
+  pm.rand ^= pm.rand >> 17;
+  pm.rand ^= pm.rand << 5;
+  return pm.rand;
+}
+
+/* Uniform in [-range, range] */
+static int spread(int range) {
+  return range > 0 ? (int)(next_rand() % (2 * range + 1)) - range : 0;
+}
+
+void pm_default_config(pm_config_t *c) {
+  memset(c, 0, sizeof(*c));
+  c->seed = 1;
+  c->rd_center = 2;
+  c->rd_width = 20;
+  c->wr_center = 4;
+  c->wr_width = 20;
+  c->skew = 3;
+  c->en_start_ps = 3 * PTAP_PS;
+  c->en_width_ps = 1500;
+  c->en_skew_ps = 200;
+  c->rlat = 14;
+  c->t_wl = 6;
+  c->t_rl = 7;
+  c->noise = 1;
+  c->noise_ppm = 5000;
+  c->apb_ns = 100;
+  c->burst_cycles = 16;
+}
+
+void pm_init(const pm_config_t *c) {
+  unsigned long reg_file[sizeof(pm.reg_file) / sizeof(pm.reg_file[0])];
+  unsigned long rw_rom[sizeof(pm.rw_rom) / sizeof(pm.rw_rom[0])];
+  int g, p;
+
+  memcpy(reg_file, pm.reg_file, sizeof(reg_file));
+  memcpy(rw_rom, pm.rw_rom, sizeof(rw_rom));
+  memset(&pm, 0, sizeof(pm));
+  pm.c = *c;
+  if (c->warm) {
+    memcpy(pm.reg_file, reg_file, sizeof(reg_file));
+    memcpy(pm.rw_rom, rw_rom, sizeof(rw_rom));
+  }
+  pm.rand = c->seed ? c->seed : 1;
+
+  for (g = 0; g < PM_GROUPS; g++) {
+    for (p = 0; p < PM_DQ; p++) {
+      pm.rd_lo[g][p] = c->rd_center + spread(c->skew) - (c->rd_width - 1) / 2;
+      pm.rd_hi[g][p] = pm.rd_lo[g][p] + c->rd_width - 1;
+    }
+    for (p = 0; p < PM_PINS; p++) {
+      pm.wr_lo[g][p] = c->wr_center + spread(c->skew) - (c->wr_width - 1) / 2;
+      pm.wr_hi[g][p] = pm.wr_lo[g][p] + c->wr_width - 1;
+    }
+    pm.en_lo[g] = c->en_start_ps + (spread(c->en_skew_ps) + c->en_skew_ps) / 2;
+  }
+}
+
+void pm_get_stats(pm_stats_t *s) {
+  *s = pm.stats;
+}
+
+void pm_get_group(int group, pm_group_t *g) {
+  *g = pm.active[group];
+  g->vfifo = pm.vfifo[group];
+}
+
+unsigned long pm_cycles(void) {
+  return pm.stats.time_ns;
+}
+
+int pm_rlat(void) {
+  return pm.phy[PHY_CSR_RLAT / 4];
+}
+
+unsigned long pm_reg_file(unsigned int offset) {
+  return pm.reg_file[(offset & 0x7ff) / 4];
+}
+
+unsigned long pm_rw_rom(unsigned int offset) {
+  return pm.rw_rom[((offset - RW_ROM_INST) & 0x7ff) / 4];
+}
+
+static int eye_margin(int x, int lo, int hi) {
+  if (x < lo) return x - lo;
+  if (x > hi) return hi - x;
+  return x - lo < hi - x ? x - lo : hi - x;
+}
+
+int pm_read_margin(int group, int pin) {
+  const pm_group_t *a = &pm.active[group];
+
+  return eye_margin(a->dqs_in - a->dq_in[pin], pm.rd_lo[group][pin],
+                    pm.rd_hi[group][pin]);
+}
+
+int pm_write_margin(int group, int pin) {
+  const pm_group_t *a = &pm.active[group];
+
+  return eye_margin(a->out1[pin] - a->out1[PM_PIN_DQS], pm.wr_lo[group][pin],
+                    pm.wr_hi[group][pin]);
+}
+
+int pm_en_margin(int group) {
+  const pm_group_t *a = &pm.active[group];
+  int t = (pm.vfifo[group] % READ_VALID_FIFO_SIZE) * CYCLE_PS +
+    a->en_phase * PTAP_PS + a->en_delay * DTAP_PS;
+  int d = ((t - pm.en_lo[group]) % RING_PS + RING_PS) % RING_PS;
+  int w = pm.c.en_width_ps;
+
+  if (d <= w)
+    return d < w - d ? d : w - d;
+  return -(d - w < RING_PS - d ? d - w : RING_PS - d);
+}
+
+/* Does a pin with this margin fail at least one of the bursts? */
+static int fails(int margin, int noise, unsigned long bursts) {
+  if (margin < 0)
+    return 1;
+  if (margin >= noise)
+    return 0;
+  while (bursts--)
+    if (next_rand() % 1000000 < (unsigned int) pm.c.noise_ppm)
+      return 1;
+  return 0;
+}
+
+/* Error bits, 1 for each failing DQ, of a test on one group */
+static unsigned long run_test(int group, enum test test, unsigned long bursts) {
+  unsigned long err = 0;
+  int p;
+
+  if (fails(pm_en_margin(group), pm.c.noise * DTAP_PS, bursts) ||
+      pm_rlat() < pm.c.rlat ||
+      (test == TEST_WRITE_DM &&
+       fails(pm_write_margin(group, PM_PIN_DM), pm.c.noise, bursts)))
+    return (1 << PM_DQ) - 1;
+
+  for (p = 0; p < PM_DQ; p++)
+    if (fails(pm_read_margin(group, p), pm.c.noise, bursts) ||
+        (test != TEST_READ &&
+         fails(pm_write_margin(group, p), pm.c.noise, bursts)))
+      err |= 1 << p;
+  return err;
+}
+
+static void run(unsigned int offset, unsigned long inst) {
+  enum test test = TEST_NONE;
+  unsigned long cycles = 16, bursts = 1;
+  int g, all = offset >= RW_RUN_ALL_GROUPS;
+
+  switch (inst) {
+  case __RW_MGR_GUARANTEED_READ:
+    test = TEST_READ;
+    break;
+  case __RW_MGR_READ_B2B:
+    test = TEST_READ;
+    bursts = pm.rw_cntr[0] + 1;
+    break;
+  case __RW_MGR_LFSR_WR_RD_BANK_0:
+  case __RW_MGR_LFSR_WR_RD_BANK_0_WL_1:
+    test = TEST_WRITE;
+    bursts = 2 * (pm.rw_cntr[0] + 1);
+    break;
+  case __RW_MGR_LFSR_WR_RD_DM_BANK_0:
+  case __RW_MGR_LFSR_WR_RD_DM_BANK_0_WL_1:
+    test = TEST_WRITE_DM;
+    bursts = 2 * (pm.rw_cntr[0] + 1);
+    break;
+  case __RW_MGR_IDLE_LOOP1:
+    cycles = pm.rw_cntr[1] + 1;
+    break;
+  case __RW_MGR_IDLE_LOOP2:
+    cycles = (pm.rw_cntr[0] + 1) * (pm.rw_cntr[1] + 1);
+    break;
+  }
+
+  pm.rw_result = 0;
+  if (test != TEST_NONE) {
+    if (all)
+      for (g = 0; g < PM_GROUPS; g++)
+        pm.rw_result |= run_test(g, test, bursts);
+    else
+      pm.rw_result = run_test((offset >> 2) % PM_GROUPS, test, bursts);
+    if (all)
+      bursts *= PM_GROUPS;
+    cycles = bursts * pm.c.burst_cycles;
+    pm.stats.tests++;
+    pm.stats.bursts += bursts;
+  }
+  pm.stats.time_ns += cycles * CLOCK_PS / 1000;
+}
+
+/* Load the staged settings of one group, or of all, into the chains */
+static void load(unsigned int reg, unsigned long item) {
+  pm_group_t *c = &pm.chain[pm.group];
+  int g = pm.group, i;
+
+  switch (reg) {
+  case SCC_DQS_ENA:
+    for (g = 0; g < PM_GROUPS; g++)
+      if (item == ALL_ITEMS || item == (unsigned long) g) {
+        pm.chain[g].dqs_in = pm.scc[(SCC_DQS_IN_DELAY >> 2) + g];
+        pm.chain[g].en_phase = pm.scc[(SCC_DQS_EN_PHASE >> 2) + g];
+        pm.chain[g].en_delay = pm.scc[(SCC_DQS_EN_DELAY >> 2) + g] -
+          IO_DQS_EN_DELAY_OFFSET;
+      }
+    break;
+  case SCC_DQS_IO_ENA:
+    c->out1[PM_PIN_DQS] = pm.pin_out1[g][PM_PIN_DQS];
+    break;
+  case SCC_DQ_ENA:
+    for (i = 0; i < PM_DQ; i++)
+      if (item == ALL_ITEMS || item == (unsigned long) i) {
+        c->dq_in[i] = pm.pin_in[g][i];
+        c->out1[i] = pm.pin_out1[g][i];
+      }
+    break;
+  case SCC_DM_ENA:
+    c->out1[PM_PIN_DM] = pm.pin_out1[g][PM_PIN_DM];
+    break;
+  }
+}
+
+static void scc_write(unsigned int offset, unsigned long data) {
+  unsigned int pin = (offset & 0xff) >> 2;
+  unsigned long *reg = NULL;
+  pm_group_t chain[PM_GROUPS];
+
+  switch (offset & ~0xff) {
+  case SCC_IO_OUT1_DELAY:
+    if (pin < PM_PINS)
+      reg = &pm.pin_out1[pm.group][pin];
+    break;
+  case SCC_IO_IN_DELAY:
+    if (pin < PM_PINS)
+      reg = &pm.pin_in[pm.group][pin];
+    break;
+  default:
+    reg = &pm.scc[offset >> 2];
+    break;
+  }
+  if (reg == NULL)
+    return;
+
+  switch (offset) {
+  case SCC_GROUP_COUNTER:
+    pm.stats.idle_scc += *reg == data;
+    pm.group = data % PM_GROUPS;
+    break;
+  case SCC_DQS_ENA:
+  case SCC_DQS_IO_ENA:
+  case SCC_DQ_ENA:
+  case SCC_DM_ENA:
+    memcpy(chain, pm.chain, sizeof(chain));
+    load(offset, data);
+    pm.stats.idle_scc += !memcmp(chain, pm.chain, sizeof(chain));
+    break;
+  case SCC_UPD:
+    pm.stats.idle_scc += !memcmp(pm.active, pm.chain, sizeof(pm.active));
+    memcpy(pm.active, pm.chain, sizeof(pm.active));
+    pm.stats.updates++;
+    break;
+  default:
+    pm.stats.idle_scc += *reg == data;
+    break;
+  }
+  *reg = data;
+}
+
+static unsigned long scc_read(unsigned int offset) {
+  unsigned int pin = (offset & 0xff) >> 2;
+
+  switch (offset & ~0xff) {
+  case SCC_IO_OUT1_DELAY:
+    return pin < PM_PINS ? pm.pin_out1[pm.group][pin] : 0;
+  case SCC_IO_IN_DELAY:
+    return pin < PM_PINS ? pm.pin_in[pm.group][pin] : 0;
+  }
+  return pm.scc[offset >> 2];
+}
+
+static void phy_write(unsigned int offset, unsigned long data) {
+  int g;
+
+  if (offset == PHY_CMD_INC_VFIFO)
+    for (g = 0; g < PM_GROUPS; g++)
+      if (data == ALL_ITEMS || data == (unsigned long) g)
+        pm.vfifo[g] = (pm.vfifo[g] + 1) % READ_VALID_FIFO_SIZE;
+  if (offset & PHY_CSR)
+    pm.phy[offset >> 2] = data;
+}
+
+static unsigned long phy_read(unsigned int offset) {
+  switch (offset) {
+  case PHY_MAX_RLAT_WIDTH: return MAX_LATENCY_COUNT_WIDTH;
+  case PHY_CALIB_VFIFO:    return CALIB_VFIFO_OFFSET;
+  case PHY_CALIB_LFIFO:    return CALIB_LFIFO_OFFSET;
+  case PHY_MEM_T_WL:       return pm.c.t_wl;
+  case PHY_MEM_T_RL:       return pm.c.t_rl;
+  }
+  return offset & PHY_CSR ? pm.phy[offset >> 2] : 0;
+}
+
+static unsigned long data_read(unsigned int offset) {
+  switch (offset) {
+  case DATA_MEM_T_WL:  return pm.c.t_wl;
+  case DATA_MEM_T_ADD: return 0;
+  case DATA_MEM_T_RL:  return pm.c.t_rl;
+  }
+  return pm.data[offset >> 2];
+}
+
+/* Split an APB address into a manager and an offset in its window */
+static enum pm_mgr decode(unsigned long a, unsigned int *offset) {
+  if (a >= MMR_BASE && a < MMR_BASE + 0x1000) {
+    *offset = a - MMR_BASE;
+    return PM_MMR;
+  }
+  if (a >= REG_FILE_BASE && a < REG_FILE_BASE + 0x800) {
+    *offset = a - REG_FILE_BASE;
+    return PM_REG_FILE;
+  }
+  if (a >= DATA_BASE && a < DATA_BASE + 0x800) {
+    *offset = a - DATA_BASE;
+    return PM_DATA;
+  }
+  if (a >= RW_BASE && a < RW_BASE + RW_WINDOW) {
+    *offset = a - RW_BASE;
+    return PM_RW;
+  }
+  if (a >= PHY_BASE && a < PHY_BASE + 0x80) {
+    *offset = a - PHY_BASE;
+    return PM_PHY;
+  }
+  *offset = (a - SCC_BASE) & 0xfff;
+  return PM_SCC;
+}
+
+void write_register(unsigned long base, unsigned long addr,
+                    unsigned long data) {
+  unsigned int offset;
+  enum pm_mgr m = decode(addr - base, &offset);
+
+  pm.stats.writes[m]++;
+  pm.stats.time_ns += pm.c.apb_ns;
+  offset &= ~3;
+
+  switch (m) {
+  case PM_SCC:
+    scc_write(offset, data);
+    break;
+  case PM_PHY:
+    phy_write(offset, data);
+    break;
+  case PM_RW:
+    if (offset < RW_LOAD_CNTR)
+      run(offset, data);
+    else if (offset < RW_LOAD_CNTR + 0x10)
+      pm.rw_cntr[(offset - RW_LOAD_CNTR) >> 2] = data;
+    else if (offset >= RW_ROM_INST)
+      pm.rw_rom[(offset - RW_ROM_INST) >> 2] = data;
+    break;
+  case PM_DATA:
+    pm.data[offset >> 2] = data;
+    break;
+  case PM_REG_FILE:
+    pm.reg_file[offset >> 2] = data;
+    break;
+  case PM_MMR:
+    pm.mmr[offset >> 2] = data;
+    break;
+  default:
+    break;
+  }
+}
+
+unsigned long read_register(unsigned long base, unsigned long addr) {
+  unsigned int offset;
+  enum pm_mgr m = decode(addr - base, &offset);
+
+  pm.stats.reads[m]++;
+  pm.stats.time_ns += pm.c.apb_ns;
+  offset &= ~3;
+
+  switch (m) {
+  case PM_SCC:      return scc_read(offset);
+  case PM_PHY:      return phy_read(offset);
+  case PM_RW:       return offset == 0 ? pm.rw_result : 0;
+  case PM_DATA:     return data_read(offset);
+  case PM_REG_FILE: return pm.reg_file[offset >> 2];
+  case PM_MMR:      return pm.mmr[offset >> 2];
+  default:          return 0;
+  }
+}
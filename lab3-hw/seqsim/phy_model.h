@@ -0,0 +1,109 @@
+/*
+ * Behavioural model of the Cyclone V hard memory PHY, as sequencer.c
+ * sees it through write_register() and read_register()
+ *
+ * The model decodes the APB addresses of the SCC manager, RW manager,
+ * PHY manager, data manager and register file.  Delay settings go
+ * through the SCC staging registers, are loaded into a group's scan
+ * chain by the *_ENA registers and take effect on SCC_MGR_UPD, as on
+ * the chip.  An RW manager test passes or fails bit by bit against:
+ *
+ *   DQS enable   the strobe gate, at VFIFO * cycle + phase * ptap +
+ *                delay * dtap, must lie in a per-group window of the
+ *                16-cycle VFIFO ring
+ *   read eye     DQS in delay - DQ in delay must lie in a per-bit
+ *                window of taps
+ *   write eye    DQ (or DM) out delay - DQS out delay must lie in a
+ *                per-pin window of taps
+ *   latency      PHY_RLAT must be at least the read latency
+ *
+ * A bit within noise taps of an edge of its eye still fails each burst
+ * with a small probability, so edges flicker as they do on a board.
+ *
+ * Time is simulated: each APB access, memory burst and idle loop of
+ * the RW manager adds to a clock.  The sequencer's own instructions
+ * are not counted.
+ */
+
+#ifndef _PHY_MODEL_H
+#define _PHY_MODEL_H
+
+#include "sequencer_defines.h"
+
+#define PM_GROUPS   RW_MGR_MEM_IF_READ_DQS_WIDTH
+#define PM_DQ       RW_MGR_MEM_DQ_PER_READ_DQS
+#define PM_PINS     (PM_DQ + 2)   /* DQ, then DQS, then DM */
+#define PM_PIN_DQS  PM_DQ
+#define PM_PIN_DM   (PM_DQ + 1)
+
+/* The managers, for access counts */
+enum pm_mgr { PM_SCC, PM_PHY, PM_RW, PM_DATA, PM_REG_FILE, PM_MMR, PM_MGRS };
+
+typedef struct {
+  unsigned int seed;         /* Per-bit eye offsets and noise */
+  int rd_center;             /* DQS in - DQ in at the read eye center */
+  int rd_width;              /* Taps in each read eye */
+  int wr_center;             /* DQ out - DQS out at the write eye center */
+  int wr_width;              /* Taps in each write eye */
+  int skew;                  /* Eye centers vary by up to this many taps */
+  int en_start_ps;           /* First passing DQS enable, in ps */
+  int en_width_ps;           /* Width of the DQS enable window */
+  int en_skew_ps;            /* Window starts vary by up to this */
+  int rlat;                  /* Smallest PHY_RLAT that reads correctly */
+  int t_wl, t_rl;            /* CAS write and read latencies reported */
+  int noise;                 /* Taps inside an edge that are marginal */
+  int noise_ppm;             /* Chance a marginal bit fails, per burst */
+  int apb_ns;                /* One APB access */
+  int burst_cycles;          /* One test burst, in memory clocks */
+  int warm;                  /* pm_init keeps the register file and ROMs */
+} pm_config_t;
+
+typedef struct {
+  unsigned long long reads[PM_MGRS];
+  unsigned long long writes[PM_MGRS];
+  unsigned long long tests;     /* RW manager read and write tests */
+  unsigned long long bursts;    /* Memory bursts in those tests */
+  unsigned long long updates;   /* SCC_MGR_UPD */
+  unsigned long long idle_scc;  /* SCC writes that changed nothing */
+  unsigned long long time_ns;   /* Simulated */
+} pm_stats_t;
+
+/* The settings in effect for one group, after the last SCC_MGR_UPD */
+typedef struct {
+  int vfifo, en_phase, en_delay, dqs_in;
+  int dq_in[PM_DQ];
+  int out1[PM_PINS];
+} pm_group_t;
+
+void pm_default_config(pm_config_t *c);
+
+/* Reset the model to power-up state with a configuration, or with warm
+   set, the PHY but for its register file and RW manager ROMs */
+void pm_init(const pm_config_t *c);
+
+void pm_get_stats(pm_stats_t *s);
+void pm_get_group(int group, pm_group_t *g);
+int pm_rlat(void);
+
+/* Simulated time in ns, for the calibration profile */
+unsigned long pm_cycles(void);
+
+/* Register file word at a byte offset, as the sequencer left it */
+unsigned long pm_reg_file(unsigned int offset);
+
+/* RW manager ROM word at a byte offset: the instruction ROM from
+   RW_ROM_INST, the AC ROM from RW_ROM_AC */
+#define RW_ROM_INST 0x1800
+#define RW_ROM_AC   0x1C00
+unsigned long pm_rw_rom(unsigned int offset);
+
+/*
+ * Taps (or, for DQS enable, ps) from the settings in effect to the
+ * nearest edge of each eye; negative if outside it.  pin is a DQ, or
+ * PM_PIN_DM for the write margin of DM.
+ */
+int pm_read_margin(int group, int pin);
+int pm_write_margin(int group, int pin);
+int pm_en_margin(int group);
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * Host stand-in for the preloader's sdram.h, used by sequencer.c
+ * through sdram_io.h when it is built against the PHY model
+ *
+ * The manager windows are at their offsets in the real SDRAM
+ * controller's APB space, with the controller itself at 0.  Only the
+ * PHYCTRL fields sequencer.c sets are defined.
+ */
+
+#ifndef _SDRAM_H
+#define _SDRAM_H
+
+#define HPS_SDR_BASE                  0
+
+#define SDR_PHYGRP_SCCGRP_ADDRESS 0x0
+#define SDR_PHYGRP_PHYMGRGRP_ADDRESS 0x1000
+#define SDR_PHYGRP_RWMGRGRP_ADDRESS 0x2000
+#define SDR_PHYGRP_DATAMGRGRP_ADDRESS 0x4000
+#define SDR_PHYGRP_REGFILEGRP_ADDRESS 0x4800
+#define SDR_CTRLGRP_ADDRESS 0x5000
+
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_OFFSET 0x150
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_1_OFFSET 0x154
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_2_OFFSET 0x158
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_SAMPLECOUNT_19_0_WIDTH 20
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_1_LONGIDLESAMPLECOUNT_19_0_WIDTH 20
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_ACDELAYEN_SET(x) (((x) & 3) << 0)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_DQDELAYEN_SET(x) (((x) & 3) << 2)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_DQSDELAYEN_SET(x) (((x) & 3) << 4)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_DQSLOGICDELAYEN_SET(x) (((x) & 3) << 6)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_RESETDELAYEN_SET(x) (((x) & 1) << 8)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_LPDDRDIS_SET(x) (((x) & 1) << 9)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_ADDLATSEL_SET(x) (((x) & 3) << 10)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_SAMPLECOUNT_19_0_SET(x) (((x) & 0xfffff) << 12)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_1_SAMPLECOUNT_31_20_SET(x) (((x) & 0xfff) << 0)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_1_LONGIDLESAMPLECOUNT_19_0_SET(x) (((x) & 0xfffff) << 12)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_2_LONGIDLESAMPLECOUNT_31_20_SET(x) (((x) & 0xfff) << 0)
+
+/* The PHY model: an APB access of the controller at base + addr */
+void write_register(unsigned long, unsigned long, unsigned long);
+unsigned long read_register(unsigned long, unsigned long);
+
+/* Profile calibration in simulated ns rather than CPU cycles */
+unsigned long pm_cycles(void);
+#define CAL_PROFILE_CYCLES() pm_cycles()
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ * Run the preloader's SDRAM calibration (sequencer.c) on the host,
+ * against the PHY model, and print the result as JSON
+ *
+ * seqsim [-s seed] [-r read eye] [-w write eye] [-k skew] [-e enable ps]
+ *        [-l read latency] [-n noise taps] [-p noise ppm] [-a apb ns]
+ *        [-b boots] [-d drift taps] [-c] [-W]
+ *
+ * The JSON has the pass/fail result, the read and write figures of
+ * merit print_report shows, simulated calibration time, APB accesses
+ * per manager, test and burst counts, SCC writes that changed nothing in
+ * the model, and per group the
+ * settings calibration chose with the margins left on each side of
+ * them.  Last comes cal_profile, the time and register accesses of
+ * each calibration stage and group, if the sequencer was built with
+ * ENABLE_CAL_PROFILE.  The exit status is nonzero if
+ * calibration failed or left any eye closed.
+ *
+ * -b boots the model that many times, printing an object for each.  With
+ * ENABLE_CAL_CACHE, the calibration cache is kept from one boot to the
+ * next; cal_cache says whether the boot restored it.  Before each boot
+ * after the first, -d moves the read and write eyes by some taps and -c
+ * flips a bit of the cache, so the restored settings have to be
+ * rejected.  With -W, boots
+ * after the first are warm: the PHY keeps its register file and RW
+ * manager ROMs.  rom says whether the ROMs hold the sequencer's images
+ * after calibration; if not, the boot fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "phy_model.h"
+#include "alt_types.h"
+#include "system.h"
+#include "sdram_io.h"
+
+/* sequencer.h declares some of sequencer.c's functions extern inline */
+#define inline
+#include "sequencer.h"
+#undef inline
+
+#if ENABLE_CAL_CACHE
+static const char *cache_states[] = { "none", "restored", "rejected" };
+
+#define CACHE_OPTS "d:c"
+#define CACHE_USAGE "[-d drift taps per boot] [-c] "
+#else
+#define CACHE_OPTS ""
+#define CACHE_USAGE ""
+#endif
+
+static const char *mgr_names[PM_MGRS] =
+  { "scc", "phy", "rw", "data", "reg_file", "mmr" };
+
+#if ENABLE_CAL_PROFILE
+static const char *stage_names[CAL_PROFILE_STAGES] =
+  { "nil", "vfifo", "wlevel", "lfifo", "writes", "fulltest", "refresh",
+    "cal_skipped", "cal_aborted", "vfifo_after_writes" };
+
+static void print_count(const cal_profile_count_t *c) {
+  int m;
+
+  printf("\"ns\": %lu, \"reads\": [", (unsigned long) c->cycles);
+  for (m = 0; m < CAL_PROFILE_MGRS; m++)
+    printf("%s%lu", m ? ", " : "", (unsigned long) c->reads[m]);
+  printf("], \"writes\": [");
+  for (m = 0; m < CAL_PROFILE_MGRS; m++)
+    printf("%s%lu", m ? ", " : "", (unsigned long) c->writes[m]);
+  printf("], \"tests\": %lu, \"retests\": %lu, \"deskew\": %lu, "
+         "\"saved\": %lu", (unsigned long) c->tests,
+         (unsigned long) c->retests, (unsigned long) c->deskew,
+         (unsigned long) c->saved);
+}
+
+/*
+ * cal_profile as JSON: the stages calibration spent time in, each with
+ * its groups.  Access counts are for scc, rw, phy, reg_file and other;
+ * tests are read and write tests, retests those that confirmed an edge,
+ * deskew those the read and write deskew searches ran, and saved the
+ * SCC accesses the sequencer's shadow left out.
+ */
+static void print_profile(void) {
+  int s, g, n = 0;
+
+  printf("\"profile\": {\"total\": {");
+  print_count(&cal_profile.total);
+  printf("}, \"stages\": [");
+  for (s = 0; s < CAL_PROFILE_STAGES; s++) {
+    if (cal_profile.stage[s].cycles == 0)
+      continue;
+    printf("%s\n  {\"stage\": \"%s\", ", n++ ? "," : "", stage_names[s]);
+    print_count(&cal_profile.stage[s]);
+    printf(", \"groups\": [");
+    for (g = 0; g < MAX_DQS; g++) {
+      printf(g ? ",\n   {" : "\n   {");
+      print_count(&cal_profile.group[s][g]);
+      printf("}");
+    }
+    printf("]}");
+  }
+  printf("]}");
+}
+#endif
+
+/* Whether the RW manager ROMs hold the sequencer's images */
+static int rom_ok(void) {
+  alt_u32 i;
+
+  for (i = 0; i < inst_rom_init_size; i++)
+    if (pm_rw_rom(RW_ROM_INST + 4 * i) != inst_rom_init[i])
+      return 0;
+  for (i = 0; i < ac_rom_init_size; i++)
+    if (pm_rw_rom(RW_ROM_AC + 4 * i) != ac_rom_init[i])
+      return 0;
+  return 1;
+}
+
+/* Smallest of a group's margins, by the function given */
+static int min_margin(int (*margin)(int, int), int group) {
+  int p, m, min = 1000;
+
+  for (p = 0; p < PM_DQ; p++)
+    if ((m = margin(group, p)) < min)
+      min = m;
+  return min;
+}
+
+/*
+ * One boot's result as a JSON object; returns nonzero if calibration
+ * failed or left an eye closed
+ */
+static int print_boot(const pm_config_t *cfg, int boot, int pass) {
+  pm_stats_t st;
+  pm_group_t g;
+  int closed = 0, rom = rom_ok(), i, rd, wr, dm, en;
+
+  pm_get_stats(&st);
+
+  printf("{\"seed\": %u, \"boot\": %d, ", cfg->seed, boot);
+#if ENABLE_CAL_CACHE
+  printf("\"cal_cache\": \"%s\", ", cache_states[cal_cache_state]);
+#endif
+  printf("\"result\": \"%s\", \"rom\": \"%s\", \"failing_stage\": \"0x%08lx\", "
+         "\"fom_in\": %lu, \"fom_out\": %lu, "
+         "\"time_us\": %.1f, \"tests\": %llu, \"bursts\": %llu, "
+         "\"updates\": %llu, \"idle_scc\": %llu, \"rlat\": %d, \"apb\": {",
+         pass ? "pass" : "fail",
+         rom ? "ok" : "bad", pm_reg_file(REG_FILE_FAILING_STAGE),
+         pm_reg_file(REG_FILE_FOM) & 0xff, pm_reg_file(REG_FILE_FOM) >> 8 & 0xff,
+         st.time_ns / 1e3, st.tests, st.bursts, st.updates, st.idle_scc,
+         pm_rlat());
+  for (i = 0; i < PM_MGRS; i++)
+    printf("%s\"%s\": [%llu, %llu]", i ? ", " : "", mgr_names[i],
+           st.reads[i], st.writes[i]);
+  printf("}, \"groups\": [");
+
+  for (i = 0; i < PM_GROUPS; i++) {
+    pm_get_group(i, &g);
+    rd = min_margin(pm_read_margin, i);
+    wr = min_margin(pm_write_margin, i);
+    dm = pm_write_margin(i, PM_PIN_DM);
+    en = pm_en_margin(i);
+    closed |= rd < 0 || wr < 0 || dm < 0 || en < 0;
+    printf("%s\n {\"vfifo\": %d, \"en_phase\": %d, \"en_delay\": %d, "
+           "\"dqs_in\": %d, \"dqs_out\": %d, \"en_margin_ps\": %d, "
+           "\"read_margin\": %d, \"write_margin\": %d, \"dm_margin\": %d}",
+           i ? "," : "", g.vfifo, g.en_phase, g.en_delay, g.dqs_in,
+           g.out1[PM_PIN_DQS], en, rd, wr, dm);
+  }
+  printf("]");
+#if ENABLE_CAL_PROFILE
+  printf(",\n");
+  print_profile();
+#endif
+  printf("}\n");
+  return !pass || closed || !rom;
+}
+
+int main(int argc, char *argv[])
+{
+  pm_config_t cfg;
+  int boots = 1, warm = 0, fail = 0, b, c;
+#if ENABLE_CAL_CACHE
+  int drift = 0, corrupt = 0;
+#endif
+#if ENABLE_CAL_HINTS
+  const cal_hints_t boot_hints = cal_hints;
+#endif
+
+  pm_default_config(&cfg);
+  while ((c = getopt(argc, argv, "s:r:w:k:e:l:n:p:a:b:W" CACHE_OPTS)) != -1)
+    switch (c) {
+    case 's': cfg.seed = strtoul(optarg, NULL, 0); break;
+    case 'r': cfg.rd_width = strtol(optarg, NULL, 0); break;
+    case 'w': cfg.wr_width = strtol(optarg, NULL, 0); break;
+    case 'k': cfg.skew = strtol(optarg, NULL, 0); break;
+    case 'e': cfg.en_width_ps = strtol(optarg, NULL, 0); break;
+    case 'l': cfg.rlat = strtol(optarg, NULL, 0); break;
+    case 'n': cfg.noise = strtol(optarg, NULL, 0); break;
+    case 'p': cfg.noise_ppm = strtol(optarg, NULL, 0); break;
+    case 'a': cfg.apb_ns = strtol(optarg, NULL, 0); break;
+    case 'b': boots = strtol(optarg, NULL, 0); break;
+    case 'W': warm = 1; break;
+#if ENABLE_CAL_CACHE
+    case 'd': drift = strtol(optarg, NULL, 0); break;
+    case 'c': corrupt = 1; break;
+#endif
+    default: goto usage;
+    }
+  if (optind != argc || boots < 1)
+    goto usage;
+
+  /* cal_cache, like a handoff region, lasts from one boot to the next */
+  for (b = 0; b < boots; b++) {
+    if (b > 0) {
+#if ENABLE_CAL_CACHE
+      cfg.rd_center += drift;
+      cfg.wr_center += drift;
+      if (corrupt)
+        cal_cache.dq_in_delay[0] ^= 1;
+#endif
+      cfg.warm = warm;
+    }
+#if ENABLE_CAL_HINTS
+    /* Unlike cal_cache, cal_hints starts afresh on a real boot */
+    cal_hints = boot_hints;
+#endif
+    pm_init(&cfg);
+    fail |= print_boot(&cfg, b, sdram_calibration());
+  }
+  return fail;
+
+ usage:
+  fprintf(stderr, "usage: %s [-s seed] [-r read eye taps] "
+          "[-w write eye taps] [-k skew taps] [-e enable window ps] "
+          "[-l read latency] [-n noise taps] [-p noise ppm] [-a apb ns] "
+          "[-b boots] " CACHE_USAGE "[-W]\n",
+          argv[0]);
+  return 1;
+}
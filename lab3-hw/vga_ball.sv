@@ -7,9 +7,69 @@
  * Register map:
  * 
  * Byte Offset  7 ... 0   Meaning
- *        0    |  Red  |  Red component of background color (0-255)
- *        1    | Green |  Green component
- *        2    | Blue  |  Blue component
+ *        0    | Color |  Palette index of the circle color
+ *        3    |  X_H  |  Circle center X, upper 8 bits
+ *        4    |  X_L  |  Circle center X, lower 8 bits
+ *        5    |  Y_H  |  Circle center Y, upper 8 bits
+ *        6    |  Y_L  |  Circle center Y, lower 8 bits
+ *        7    |   R   |  Circle radius in pixels (0-255)
+ *        8    | Color |  Palette index of the background color
+ *       11    | Ctrl  |  Bit 0: enable the tile layer
+ *             |       |  Bit 1: enable the per-line scroll table
+ *       12    |  Pal  |  Tile palette: pixel value p (1-3) uses
+ *             |       |  palette entry {bits 5:0, p}
+ *       21    | SX_H  |  Tile layer scroll X, bits 9:8
+ *       22    | SX_L  |  Tile layer scroll X, bits 7:0
+ *       23    | SY_H  |  Tile layer scroll Y, bit 8
+ *       24    | SY_L  |  Tile layer scroll Y, bits 7:0
+ *    32-35    | Desc  |  DMA first descriptor address, bits 31:24 first
+ *       36    | Ctrl  |  Write bit 0: start DMA; bit 1: DMA done
+ *             |       |  interrupt enable; bit 2: vblank interrupt enable
+ *       37    | Stat  |  Read bit 0: DMA busy; bit 1: DMA done;
+ *             |       |  bit 2: vertical blank started.  Write 1s to
+ *             |       |  clear bits 1 and 2.
+ *
+ * 0x0400-0x07FF  Palette: 256 entries of four bytes: red, green, blue,
+ *                unused
+ * 0x0800-0x0FFF  Name table: one tile number per byte, 64 columns by
+ *                32 rows, row-major
+ * 0x1000-0x1FFF  Tile patterns: 256 tiles of 8x8 pixels, 2 bits per
+ *                pixel, 16 bytes per tile, two bytes per row, leftmost
+ *                pixel in bits 7:6 of the first byte
+ * 0x2000-0x23FF  Per-line scroll table: 512 extra X scrolls, one per
+ *                scanline, two bytes each (bits 9:8, then bits 7:0)
+ *
+ * All colors go through the 256-entry palette, so changing one palette
+ * entry recolors everything that uses it.
+ *
+ * The circle center is 12.4 fixed point: X_H/X_L hold whole pixels in
+ * bits 15:4 and sixteenths of a pixel in bits 3:0 (likewise Y).
+ *
+ * The circle edge is anti-aliased: a four-stage pipeline turns
+ * r^2 - d^2 into an 8-bit coverage and blends the circle color over
+ * the background.  The sync and blanking outputs are delayed to match.
+ *
+ * Tile layer: each pattern pixel covers 2x2 screen pixels, so a tile is
+ * 16x16 on screen and 40x30 tiles cover the display.  Pixel value 0 is
+ * transparent and shows the background color; 1-3 select an entry from
+ * the layer's four-entry slice of the palette.
+ * The circle is drawn over the tile layer.
+ *
+ * The tile layer scrolls over its 1024x512-pixel name table and wraps
+ * at the edges.  Scroll registers take effect at the start of vertical
+ * blanking so a two-register update never tears.  With the per-line
+ * table enabled, each scanline adds its own X offset (for parallax).
+ *
+ * DMA: a master port copies blocks from HPS memory into the palette,
+ * name table, pattern and line scroll memories.  It walks a chain of
+ * 12-byte descriptors in memory, each three little-endian words:
+ *
+ *    0  source address (word aligned)
+ *    4  bits 13:0: destination byte offset; bits 29:16: length in bytes
+ *    8  address of the next descriptor, 0 to stop
+ *
+ * and raises its interrupt when the chain is done.  Avalon writes to
+ * the memories take priority over DMA writes.
  */
 
 module vga_ball(input logic        clk,
@@ -17,65 +77,346 @@ module vga_ball(input logic        clk,
 		input logic [7:0]  writedata,
 		input logic 	   write,
 		input 		   chipselect,
-		input logic [3:0]  address,
+		input logic [13:0] address,
+		input logic 	   read,
+		output logic [7:0] readdata,
+
+		output logic [31:0] dma_address,
+		output logic 	   dma_read,
+		input logic [31:0] dma_readdata,
+		input logic 	   dma_waitrequest,
+		input logic 	   dma_readdatavalid,
+
+		output logic 	   irq,
 
 		output logic [7:0] VGA_R, VGA_G, VGA_B,
 		output logic 	   VGA_CLK, VGA_HS, VGA_VS,
 		                   VGA_BLANK_n,
 		output logic 	   VGA_SYNC_n);
 
+   // Depth of the pixel pipeline in clk cycles
+   localparam PIPE = 4;
+
    logic [10:0]	   hcount;
    logic [9:0]     vcount;
+   logic 	   vga_clk, vga_hs, vga_vs, vga_blank_n;
 
-   logic [7:0] 	   background_r, background_g, background_b;
+   logic [7:0] 	   background_index, circle_index;
    logic [7:0]     circle_r, circle_g, circle_b;
+   logic 	   tile_en, line_en;
+   logic [9:0] 	   scroll_x, scroll_x_w;  // Active and written copies
+   logic [8:0] 	   scroll_y, scroll_y_w;
+   logic [5:0] 	   tile_palette;
+   logic [31:0]    dma_desc;
+   logic 	   dma_start, dma_busy, dma_done, dma_irq_en, dma_done_flag;
+   logic 	   vblank_irq_en, vblank_flag;
+
+   // Byte writes into the memories, from Avalon or from the DMA
+   logic 	   ram_we, dma_we;
+   logic [13:0]    ram_addr, dma_waddr;
+   logic [7:0] 	   ram_data, dma_wdata;
+
+   assign ram_we = (chipselect && write) || dma_we;
+   assign ram_addr = (chipselect && write) ? address : dma_waddr;
+   assign ram_data = (chipselect && write) ? writedata : dma_wdata;
  
  
-   logic [15:0]    circle_x,circle_y;
+   logic [15:0]    circle_x,circle_y;   // 12.4 fixed point
    logic [19:0]     circle_radius;
-   logic [19:0]    dis2, r2;
-   logic [19:0]     dis_x,dis_y;
+   logic [13:0]    px, py;              // Current pixel, 10.4
+   logic [13:0]     dis_x,dis_y;         // 10.4
+   logic [28:0]    dis2;                // 21.8
 
-   assign dis_x = (hcount[10:1] > circle_x[9:0]) ? (hcount[10:1] - circle_x[9:0]): (circle_x[9:0] - hcount[10:1]);
-   assign dis_y = (vcount[9:0] > circle_y[9:0]) ? (vcount[9:0] - circle_y[9:0]): (circle_y[9:0] - vcount[9:0]);
+   assign px = {hcount[10:1], 4'b0};
+   assign py = {vcount[9:0], 4'b0};
+   assign dis_x = (px > circle_x[13:0]) ? (px - circle_x[13:0]): (circle_x[13:0] - px);
+   assign dis_y = (py > circle_y[13:0]) ? (py - circle_y[13:0]): (circle_y[13:0] - py);
    assign dis2 = $unsigned(dis_x)*$unsigned(dis_x) + 
                  $unsigned(dis_y)*$unsigned(dis_y);
-   assign r2 = $unsigned(circle_radius)*$unsigned(circle_radius);
 	
-   vga_counters counters(.clk50(clk), .*);
+   vga_counters counters(.clk50(clk), .VGA_CLK(vga_clk), .VGA_HS(vga_hs),
+			 .VGA_VS(vga_vs), .VGA_BLANK_n(vga_blank_n), .*);
 
    always_ff @(posedge clk)
      if (reset) begin
-	background_r <= 8'h0;
-	background_g <= 8'h0;
-	background_b <= 8'h80;
+	background_index <= 8'd0;
+	circle_index <= 8'd1;
   
     circle_x <= 16'h00000000;
     circle_y <= 16'h00000000;
     circle_radius <= 20'h0;
+    tile_en <= 1'b0;
+    line_en <= 1'b0;
+    scroll_x_w <= 10'd0;
+    scroll_y_w <= 9'd0;
      end else if (chipselect && write)
        case (address)
-        4'h0 : circle_r <= writedata;
-        4'h1 : circle_g <= writedata;
-        4'h2 : circle_b <= writedata;
-        4'h3 : circle_x[15:8] <= writedata;
-        4'h4 : circle_x[7:0] <= writedata;
-        4'h5 : circle_y[15:8] <= writedata;
-        4'h6 : circle_y[7:0] <= writedata;
-        4'h7 : circle_radius[7:0] <= writedata;
-        4'h8 : background_r <= writedata;
-        4'h9 : background_g <= writedata;
-        4'ha : background_b <= writedata;
+        14'h0 : circle_index <= writedata;
+        14'h3 : circle_x[15:8] <= writedata;
+        14'h4 : circle_x[7:0] <= writedata;
+        14'h5 : circle_y[15:8] <= writedata;
+        14'h6 : circle_y[7:0] <= writedata;
+        14'h7 : circle_radius[7:0] <= writedata;
+        14'h8 : background_index <= writedata;
+        14'hb : {line_en, tile_en} <= writedata[1:0];
+        14'hc : tile_palette <= writedata[5:0];
+        14'h15 : scroll_x_w[9:8] <= writedata[1:0];
+        14'h16 : scroll_x_w[7:0] <= writedata;
+        14'h17 : scroll_y_w[8] <= writedata[0];
+        14'h18 : scroll_y_w[7:0] <= writedata;
+        14'h20 : dma_desc[31:24] <= writedata;
+        14'h21 : dma_desc[23:16] <= writedata;
+        14'h22 : dma_desc[15:8] <= writedata;
+        14'h23 : dma_desc[7:0] <= writedata;
+        default: ;
        endcase
 
+   /*
+    * DMA control
+    */
+   vga_dma dma(.clk, .reset, .desc_addr(dma_desc), .start(dma_start),
+	       .busy(dma_busy), .done(dma_done),
+	       .m_address(dma_address), .m_read(dma_read),
+	       .m_readdata(dma_readdata), .m_waitrequest(dma_waitrequest),
+	       .m_readdatavalid(dma_readdatavalid),
+	       .we(dma_we), .waddr(dma_waddr), .wdata(dma_wdata),
+	       .stall(chipselect && write));
+
+   always_ff @(posedge clk)
+     if (reset) begin
+	dma_start <= 1'b0;
+	dma_irq_en <= 1'b0;
+	dma_done_flag <= 1'b0;
+	vblank_irq_en <= 1'b0;
+	vblank_flag <= 1'b0;
+     end else begin
+	dma_start <= 1'b0;
+	if (chipselect && write && address == 14'h24) begin
+	   dma_start <= writedata[0];
+	   dma_irq_en <= writedata[1];
+	   vblank_irq_en <= writedata[2];
+	end
+	if (dma_done)
+	  dma_done_flag <= 1'b1;
+	else if (chipselect && write && address == 14'h25 && writedata[1])
+	  dma_done_flag <= 1'b0;
+	if (hcount == 11'd0 && vcount == 10'd480)
+	  vblank_flag <= 1'b1;
+	else if (chipselect && write && address == 14'h25 && writedata[2])
+	  vblank_flag <= 1'b0;
+     end
+
+   assign irq = (dma_done_flag && dma_irq_en) ||
+		(vblank_flag && vblank_irq_en);
+
+   always_comb
+     if (chipselect && read && address == 14'h25)
+       readdata = {5'b0, vblank_flag, dma_done_flag, dma_busy};
+     else
+       readdata = 8'h0;
+
+   /*
+    * Tile layer
+    *
+    * Name table and pattern RAMs are written from the Avalon side or DMA and
+    * read by the pixel pipeline, lining up with the circle stages:
+    *
+    * Stage 0: apply the scroll offsets to the pixel coordinates
+    * Stage 1: name table read at (tile row, tile column)
+    * Stage 2: pattern read at (tile number, pattern row, byte)
+    * Stage 3: select the 2-bit pixel, palette read of its color
+    *
+    * The palette is kept twice, one copy for the tile layer and one
+    * for the circle, so each gets its own read port.
+    */
+   logic [7:0] 	   name_ram[0:2047];
+   logic [7:0] 	   pattern_ram[0:4095];
+   logic [9:0] 	   tx;                  // Scrolled pixel for the tile layer
+   logic [8:0] 	   ty;
+   logic [1:0] 	   line_hi_ram[0:511];
+   logic [7:0] 	   line_lo_ram[0:511];
+   logic [8:0] 	   line_addr;
+   logic [9:0] 	   line_q, line_sx;
+   logic [10:0]    name_addr;
+   logic [11:0]    pattern_addr;
+   logic [7:0] 	   name_q, pattern_q;
+   logic [2:0] 	   prow_1, pcol_1;
+   logic [1:0] 	   pcol_2;
+   logic [1:0] 	   tpix;
+   logic [7:0] 	   tile_index;
+   logic [7:0] 	   tile_r, tile_g, tile_b;
+   logic [7:0] 	   pal_r[0:255], pal_g[0:255], pal_b[0:255];
+   logic [7:0] 	   cpal_r[0:255], cpal_g[0:255], cpal_b[0:255];
+
+   initial
+     for (int i = 0; i < 256; i++) begin
+	// Navy background (entry 0) and a white circle (entry 1)
+	pal_r[i] = i == 1 ? 8'hff : 8'h00;
+	pal_g[i] = i == 1 ? 8'hff : 8'h00;
+	pal_b[i] = i == 0 ? 8'h80 : i == 1 ? 8'hff : 8'h00;
+	cpal_r[i] = pal_r[i];
+	cpal_g[i] = pal_g[i];
+	cpal_b[i] = pal_b[i];
+     end
+
+   // Read the next line's entry during this line; latch it at the end
+   assign line_addr = vcount == 10'd524 ? 9'd0 : 9'(vcount + 10'd1);
+   assign tx = hcount[10:1] + scroll_x + (line_en ? line_sx : 10'd0);
+   assign ty = vcount[8:0] + scroll_y;
+   assign name_addr = {ty[8:4], tx[9:4]};
+   assign pattern_addr = {name_q, prow_1, pcol_1[2]};
+
+   always_ff @(posedge clk) begin
+      if (ram_we && ram_addr[13:10] == 4'b0001)
+	case (ram_addr[1:0])
+	  2'd0: begin
+	     pal_r[ram_addr[9:2]] <= ram_data;
+	     cpal_r[ram_addr[9:2]] <= ram_data;
+	  end
+	  2'd1: begin
+	     pal_g[ram_addr[9:2]] <= ram_data;
+	     cpal_g[ram_addr[9:2]] <= ram_data;
+	  end
+	  2'd2: begin
+	     pal_b[ram_addr[9:2]] <= ram_data;
+	     cpal_b[ram_addr[9:2]] <= ram_data;
+	  end
+	  default: ;
+	endcase
+      if (ram_we && ram_addr[13:11] == 3'b001)
+	name_ram[ram_addr[10:0]] <= ram_data;
+      if (ram_we && ram_addr[13:12] == 2'b01)
+	pattern_ram[ram_addr[11:0]] <= ram_data;
+      if (ram_we && ram_addr[13:10] == 4'b1000) begin
+	 if (ram_addr[0]) line_lo_ram[ram_addr[9:1]] <= ram_data;
+	 else             line_hi_ram[ram_addr[9:1]] <= ram_data[1:0];
+      end
+
+      // Stage 0
+      line_q <= {line_hi_ram[line_addr], line_lo_ram[line_addr]};
+      if (hcount == 11'd1599) line_sx <= line_q;
+      if (hcount == 11'd0 && vcount == 10'd480) begin
+	 scroll_x <= scroll_x_w;
+	 scroll_y <= scroll_y_w;
+      end
+
+      // Stage 1
+      name_q <= name_ram[name_addr];
+      prow_1 <= ty[3:1];
+      pcol_1 <= tx[3:1];
+
+      // Stage 2
+      pattern_q <= pattern_ram[pattern_addr];
+      pcol_2 <= pcol_1[1:0];
+
+      // Stage 3
+      tile_r <= pal_r[tile_index];
+      tile_g <= pal_g[tile_index];
+      tile_b <= pal_b[tile_index];
+
+      circle_r <= cpal_r[circle_index];
+      circle_g <= cpal_g[circle_index];
+      circle_b <= cpal_b[circle_index];
+   end
+
+   assign tile_index = (!tile_en || tpix == 2'd0) ? background_index :
+		       {tile_palette, tpix};
+
+   always_comb
+     case (pcol_2)
+       2'd0: tpix = pattern_q[7:6];
+       2'd1: tpix = pattern_q[5:4];
+       2'd2: tpix = pattern_q[3:2];
+       default: tpix = pattern_q[1:0];
+     endcase
+
+   /*
+    * Anti-aliasing
+    *
+    * Near the edge, the distance from the pixel to the circle is about
+    * (r^2 - d^2) / 2r, so the covered fraction of the pixel is
+    * (r^2 - d^2 + r) / 2r, clamped to [0, 1].  The division uses a
+    * 1/r table indexed by the radius register.  Distances keep the
+    * sub-pixel bits of the circle center, so the blend also moves
+    * smoothly as the center moves by fractions of a pixel.
+    *
+    * Stage 1: d^2 (21.8) and r^2
+    * Stage 2: span = r^2 - d^2 + r (in 1/16 pixel^2), inside/outside flags
+    * Stage 3: coverage = span * 128 / r            (0 - 255)
+    * Stage 4: pixel = (circle * c + tile layer * (256 - c)) / 256
+    */
+   logic [16:0]    recip_rom[0:255];   // 65536 / r
+   logic [16:0]    recip;
+
+   initial begin
+      recip_rom[0] = 17'd0;
+      for (int i = 1; i < 256; i++)
+	recip_rom[i] = 17'(65536 / i);
+   end
+
+   always_ff @(posedge clk)
+     recip <= recip_rom[circle_radius[7:0]];
+
+   logic [28:0]    dis2_q;
+   logic [15:0]    r2_q;
+   logic 	   off_q;
+   logic signed [26:0] edge_d;
+   logic [12:0]    span;
+   logic 	   span_in, span_out;
+   logic [29:0]    cov_prod;
+   logic [7:0] 	   cov;
+   logic [8:0] 	   cov9;
+   logic [15:0]    mix_r, mix_g, mix_b;
+   logic [7:0] 	   pix_r, pix_g, pix_b;
+   logic [PIPE-1:0] clk_d, hs_d, vs_d, blank_d;
+
+   assign edge_d = $signed({7'b0, r2_q, 4'b0}) - $signed({2'b0, dis2_q[28:4]}) +
+		   $signed({15'b0, circle_radius[7:0], 4'b0});
+   assign cov_prod = span * recip;
+   assign cov9 = {1'b0, cov} + cov[7];  // 255 -> 256 so the circle is exact
+   assign mix_r = circle_r * cov9 + tile_r * (9'd256 - cov9);
+   assign mix_g = circle_g * cov9 + tile_g * (9'd256 - cov9);
+   assign mix_b = circle_b * cov9 + tile_b * (9'd256 - cov9);
+
+   always_ff @(posedge clk) begin
+      // Stage 1
+      dis2_q <= dis2;
+      r2_q   <= circle_radius[7:0] * circle_radius[7:0];
+      off_q  <= circle_radius[7:0] == 8'd0 ||
+		circle_x[15:4] > 12'd1280 || circle_y[15:4] > 12'd640;
+
+      // Stage 2
+      span_out <= edge_d < 0 || off_q;
+      span_in  <= edge_d >= $signed({14'b0, circle_radius[7:0], 5'b0});
+      span     <= edge_d[12:0];
+
+      // Stage 3
+      if (span_out)    cov <= 8'd0;
+      else if (span_in) cov <= 8'd255;
+      else             cov <= cov_prod[29:13] > 17'd255 ? 8'd255 :
+			      cov_prod[20:13];
+
+      // Stage 4
+      pix_r <= mix_r[15:8];
+      pix_g <= mix_g[15:8];
+      pix_b <= mix_b[15:8];
+
+      // Delay the timing signals to line up with the pixel
+      clk_d   <= {clk_d[PIPE-2:0], vga_clk};
+      hs_d    <= {hs_d[PIPE-2:0], vga_hs};
+      vs_d    <= {vs_d[PIPE-2:0], vga_vs};
+      blank_d <= {blank_d[PIPE-2:0], vga_blank_n};
+   end
+
+   assign VGA_CLK = clk_d[PIPE-1];
+   assign VGA_HS = hs_d[PIPE-1];
+   assign VGA_VS = vs_d[PIPE-1];
+   assign VGA_BLANK_n = blank_d[PIPE-1];
+
    always_comb begin
       {VGA_R, VGA_G, VGA_B} = {8'h0, 8'h0, 8'h0};
       if (VGA_BLANK_n )
-	if (dis2<r2 && circle_x <= 16'd1280 && circle_y <= 16'd640)
-	  {VGA_R, VGA_G, VGA_B} = {circle_r, circle_g, circle_b};
-	else
-	  {VGA_R, VGA_G, VGA_B} =
-             {background_r,background_g,background_b};
+	{VGA_R, VGA_G, VGA_B} = {pix_r, pix_g, pix_b};
    end
 	       
 endmodule
@@ -157,3 +498,147 @@ module vga_counters(
    assign VGA_CLK = hcount[0]; // 25 MHz clock: rising edge sensitive
    
 endmodule
+
+/*
+ * Descriptor-driven DMA: reads HPS memory through an Avalon master and
+ * turns each word into four byte writes into the device's memories.
+ *
+ * Up to DEPTH word reads are kept in flight, limited so every word
+ * that comes back has room in the FIFO.  Bytes leave the FIFO one per
+ * cycle unless stall is asserted.
+ */
+module vga_dma(input logic         clk, reset,
+	       input logic [31:0]  desc_addr,  // First descriptor
+	       input logic 	   start,
+	       output logic 	   busy,
+	       output logic 	   done,       // Pulses when the chain ends
+
+	       output logic [31:0] m_address,
+	       output logic 	   m_read,
+	       input logic [31:0]  m_readdata,
+	       input logic 	   m_waitrequest,
+	       input logic 	   m_readdatavalid,
+
+	       output logic 	   we,
+	       output logic [13:0] waddr,
+	       output logic [7:0]  wdata,
+	       input logic 	   stall);
+
+   localparam DEPTH = 8;
+
+   enum logic [1:0] {IDLE, DESC, COPY} state;
+
+   logic [31:0]    desc_ptr, next_desc, src;
+   logic [1:0] 	   desc_i;             // Descriptor word being fetched
+   logic 	   desc_wait;          // Waiting for that word
+   logic [13:0]    len;                // Bytes left to write
+   logic [12:0]    words;              // Words left to request
+   logic [3:0] 	   pending;            // Reads in flight
+   logic [3:0] 	   count;              // Words in the FIFO
+   logic [31:0]    fifo[0:DEPTH-1];
+   logic [2:0] 	   head, tail;
+   logic [1:0] 	   byte_i;             // Next byte of the head word
+
+   logic 	   accept, pop, last;
+   logic [3:0] 	   pending_next, count_next;
+
+   assign busy = state != IDLE;
+   assign accept = m_read && !m_waitrequest;
+   assign we = state == COPY && count != 0 && len != 0 && !stall;
+   assign wdata = 8'(fifo[head] >> {byte_i, 3'b0});
+   assign pop = we && (byte_i == 2'd3 || len == 14'd1);
+   assign last = we && len == 14'd1;
+   assign pending_next = pending + accept - (state == COPY && m_readdatavalid);
+   assign count_next = count + (state == COPY && m_readdatavalid) - pop;
+
+   always_ff @(posedge clk)
+     if (reset) begin
+	state <= IDLE;
+	m_read <= 1'b0;
+	done <= 1'b0;
+     end else begin
+	done <= 1'b0;
+	case (state)
+	  IDLE:
+	    if (start) begin
+	       desc_ptr <= desc_addr;
+	       desc_i <= 2'd0;
+	       desc_wait <= 1'b0;
+	       state <= DESC;
+	    end
+
+	  // Fetch the three descriptor words one at a time
+	  DESC:
+	    if (!desc_wait && !m_read) begin
+	       m_address <= desc_ptr + {desc_i, 2'b0};
+	       m_read <= 1'b1;
+	    end else if (accept) begin
+	       m_read <= 1'b0;
+	       desc_wait <= 1'b1;
+	    end else if (desc_wait && m_readdatavalid) begin
+	       desc_wait <= 1'b0;
+	       desc_i <= desc_i + 2'd1;
+	       case (desc_i)
+		 2'd0: src <= m_readdata;
+		 2'd1: begin
+		    waddr <= m_readdata[13:0];
+		    len <= m_readdata[29:16];
+		    words <= 13'(({1'b0, m_readdata[29:16]} + 15'd3) >> 2);
+		 end
+		 default: begin
+		    next_desc <= m_readdata;
+		    m_address <= src;
+		    pending <= 4'd0;
+		    count <= 4'd0;
+		    head <= 3'd0;
+		    tail <= 3'd0;
+		    byte_i <= 2'd0;
+		    state <= COPY;
+		 end
+	       endcase
+	    end
+
+	  // Stream the block into the memories
+	  COPY: begin
+	     if (accept) begin
+		m_address <= m_address + 32'd4;
+		words <= words - 13'd1;
+	     end
+	     // Hold a request until it is accepted
+	     if (!(m_read && !accept))
+	       m_read <= words - accept != 13'd0 &&
+			 pending_next + count_next < DEPTH;
+	     pending <= pending_next;
+	     count <= count_next;
+
+	     if (m_readdatavalid) begin
+		fifo[tail] <= m_readdata;
+		tail <= tail + 3'd1;
+	     end
+
+	     if (we) begin
+		waddr <= waddr + 14'd1;
+		len <= len - 14'd1;
+		byte_i <= pop ? 2'd0 : byte_i + 2'd1;
+	     end
+	     if (pop)
+	       head <= head + 3'd1;
+
+	     if (len == 14'd0 || last) begin
+		m_read <= 1'b0;
+		if (next_desc != 32'd0) begin
+		   desc_ptr <= next_desc;
+		   desc_i <= 2'd0;
+		   state <= DESC;
+		end else begin
+		   done <= 1'b1;
+		   state <= IDLE;
+		end
+	     end
+	  end
+
+	  default: state <= IDLE;
+	endcase
+     end
+
+endmodule
@@ -119,13 +119,67 @@ set_interface_property avalon_slave_0 SVD_ADDRESS_GROUP ""
 add_interface_port avalon_slave_0 writedata writedata Input 8
 add_interface_port avalon_slave_0 write write Input 1
 add_interface_port avalon_slave_0 chipselect chipselect Input 1
-add_interface_port avalon_slave_0 address address Input 3
+add_interface_port avalon_slave_0 address address Input 14
+add_interface_port avalon_slave_0 read read Input 1
+add_interface_port avalon_slave_0 readdata readdata Output 8
 set_interface_assignment avalon_slave_0 embeddedsw.configuration.isFlash 0
 set_interface_assignment avalon_slave_0 embeddedsw.configuration.isMemoryDevice 0
 set_interface_assignment avalon_slave_0 embeddedsw.configuration.isNonVolatileStorage 0
 set_interface_assignment avalon_slave_0 embeddedsw.configuration.isPrintableDevice 0
 
 
+# 
+# connection point dma_master
+# 
+add_interface dma_master avalon start
+set_interface_property dma_master addressUnits SYMBOLS
+set_interface_property dma_master associatedClock clock
+set_interface_property dma_master associatedReset reset
+set_interface_property dma_master bitsPerSymbol 8
+set_interface_property dma_master burstOnBurstBoundariesOnly false
+set_interface_property dma_master burstcountUnits WORDS
+set_interface_property dma_master doStreamReads false
+set_interface_property dma_master doStreamWrites false
+set_interface_property dma_master holdTime 0
+set_interface_property dma_master linewrapBursts false
+set_interface_property dma_master maximumPendingReadTransactions 0
+set_interface_property dma_master maximumPendingWriteTransactions 0
+set_interface_property dma_master readLatency 0
+set_interface_property dma_master readWaitTime 1
+set_interface_property dma_master setupTime 0
+set_interface_property dma_master timingUnits Cycles
+set_interface_property dma_master writeWaitTime 0
+set_interface_property dma_master ENABLED true
+set_interface_property dma_master EXPORT_OF ""
+set_interface_property dma_master PORT_NAME_MAP ""
+set_interface_property dma_master CMSIS_SVD_VARIABLES ""
+set_interface_property dma_master SVD_ADDRESS_GROUP ""
+
+add_interface_port dma_master dma_address address Output 32
+add_interface_port dma_master dma_read read Output 1
+add_interface_port dma_master dma_readdata readdata Input 32
+add_interface_port dma_master dma_waitrequest waitrequest Input 1
+add_interface_port dma_master dma_readdatavalid readdatavalid Input 1
+
+
+# 
+# connection point interrupt_sender
+# 
+add_interface interrupt_sender interrupt end
+set_interface_property interrupt_sender associatedAddressablePoint avalon_slave_0
+set_interface_property interrupt_sender associatedClock clock
+set_interface_property interrupt_sender associatedReset reset
+set_interface_property interrupt_sender bridgedReceiverOffset ""
+set_interface_property interrupt_sender bridgesToReceiver ""
+set_interface_property interrupt_sender ENABLED true
+set_interface_property interrupt_sender EXPORT_OF ""
+set_interface_property interrupt_sender PORT_NAME_MAP ""
+set_interface_property interrupt_sender CMSIS_SVD_VARIABLES ""
+set_interface_property interrupt_sender SVD_ADDRESS_GROUP ""
+
+add_interface_port interrupt_sender irq irq Output 1
+
+
 # 
 # connection point vga
 # 
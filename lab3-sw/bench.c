@@ -0,0 +1,240 @@
+/*
+ * Frame-pacing benchmark for the vga_ball stack
+ *
+ * Drives N objects through the driver, or the simulated device, once
+ * per vertical blank and prints the results as JSON.  An object is
+ * one palette entry, so N may be up to 256.  Modes:
+ *
+ *   ioctl  one VGA_BALL_LOAD_PALETTE per object
+ *   batch  one VGA_BALL_LOAD_PALETTE for all objects
+ *   write  one pwrite() of the palette bytes (queued for vblank)
+ *   dma    one VGA_BALL_DMA_UPLOAD of the palette bytes
+ *   all    each of the above in turn, as a JSON array
+ *
+ * bench [-s] [-m mode] [-n objects] [-f frames] [-k submits/frame]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "vga_ball.h"
+#include "libvgaball.h"
+
+enum mode { MODE_IOCTL, MODE_BATCH, MODE_WRITE, MODE_DMA, MODES };
+
+static const char *mode_names[MODES] = { "ioctl", "batch", "write", "dma" };
+
+struct bench {
+  enum mode mode;
+  unsigned int objects;
+  unsigned int frames;      /* Frames left to run */
+  unsigned int submits;     /* Submissions per frame */
+  vga_ball_color_t colors[VGA_BALL_PALETTE_SIZE];
+  unsigned char bytes[4 * VGA_BALL_PALETTE_SIZE]; /* Palette layout */
+  long *latency;            /* One per submission, ns */
+  unsigned long nlatency;
+  unsigned long errors;
+};
+
+static long long now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double cpu_seconds(void) {
+  struct rusage ru;
+
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+    (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+/* Change every object so each submission carries new data */
+static void step(struct bench *b, unsigned int frame) {
+  unsigned int i;
+
+  for (i = 0; i < b->objects; i++) {
+    b->colors[i].red = frame + i;
+    b->colors[i].green = frame;
+    b->colors[i].blue = i;
+    memcpy(b->bytes + 4 * i, &b->colors[i], 3);
+  }
+}
+
+static int submit(vgb_t *v, struct bench *b) {
+  vga_ball_palette_t vlp;
+  vga_ball_block_t block;
+  vga_ball_dma_t dma;
+  unsigned int i;
+  int r = 0;
+
+  switch (b->mode) {
+  case MODE_IOCTL:
+    for (i = 0; i < b->objects && !r; i++) {
+      vlp.first = i;
+      vlp.count = 1;
+      vlp.colors = &b->colors[i];
+      r = vgb_ioctl(v, VGA_BALL_LOAD_PALETTE, (unsigned long) &vlp);
+    }
+    return r;
+
+  case MODE_BATCH:
+    vlp.first = 0;
+    vlp.count = b->objects;
+    vlp.colors = b->colors;
+    return vgb_ioctl(v, VGA_BALL_LOAD_PALETTE, (unsigned long) &vlp);
+
+  case MODE_WRITE:
+    return vgb_pwrite(v, b->bytes, 4 * b->objects, VGA_BALL_PALETTE_BASE) ==
+      (ssize_t)(4 * b->objects) ? 0 : -1;
+
+  case MODE_DMA:
+    block.offset = VGA_BALL_PALETTE_BASE;
+    block.length = 4 * b->objects;
+    block.data = b->bytes;
+    dma.count = 1;
+    dma.blocks = &block;
+    return vgb_ioctl(v, VGA_BALL_DMA_UPLOAD, (unsigned long) &dma);
+
+  default:
+    return -1;
+  }
+}
+
+static int frame(vgb_t *v, unsigned int frame, void *ctx) {
+  struct bench *b = ctx;
+  long long t;
+  unsigned int k;
+
+  step(b, frame);
+  for (k = 0; k < b->submits; k++) {
+    t = now_ns();
+    if (submit(v, b))
+      b->errors++;
+    b->latency[b->nlatency++] = now_ns() - t;
+  }
+  return --b->frames == 0;
+}
+
+static int cmp_long(const void *a, const void *b) {
+  long x = *(const long *) a, y = *(const long *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+static long percentile(const long *sorted, unsigned long n, int permille) {
+  return n ? sorted[(n - 1) * permille / 1000] : 0;
+}
+
+/* Run one mode on a fresh device and print its JSON object */
+static int run(int flags, enum mode mode, unsigned int objects,
+               unsigned int frames, unsigned int submits) {
+  struct bench *b;
+  vgb_t *v;
+  vgb_stats_t st;
+  long long t0, wall;
+  double cpu0, cpu, seen, updates;
+
+  if ((v = vgb_open(NULL, flags)) == NULL) {
+    perror("could not open /dev/vga_ball");
+    return -1;
+  }
+  if ((b = calloc(1, sizeof(*b))) == NULL ||
+      (b->latency = malloc(sizeof(long) * frames * submits)) == NULL) {
+    perror("bench");
+    free(b);
+    vgb_close(v);
+    return -1;
+  }
+  b->mode = mode;
+  b->objects = objects;
+  b->frames = frames;
+  b->submits = submits;
+
+  vgb_add_frame(v, frame, b, 0);
+
+  t0 = now_ns();
+  cpu0 = cpu_seconds();
+  if (vgb_run(v))
+    perror("vgb_run");
+  wall = now_ns() - t0;
+  cpu = cpu_seconds() - cpu0;
+  vgb_get_stats(v, &st);
+
+  qsort(b->latency, b->nlatency, sizeof(long), cmp_long);
+  updates = (double) b->nlatency * objects;
+  seen = st.frames + st.skipped;
+
+  printf("{\"device\": \"%s\", \"mode\": \"%s\", \"objects\": %u, "
+         "\"submits_per_frame\": %u, \"frames\": %llu, \"skipped\": %llu, "
+         "\"late\": %llu, \"errors\": %lu, \"seconds\": %.3f, "
+         "\"updates_per_sec\": %.1f, \"cpu_percent\": %.2f, "
+         "\"submit_ns\": {\"p50\": %ld, \"p99\": %ld, \"p999\": %ld, "
+         "\"max\": %ld}, \"on_time_percent\": %.2f}",
+         flags & VGB_SIM ? "sim" : "hw", mode_names[mode], objects,
+         submits, st.frames, st.skipped, st.late, b->errors, wall / 1e9,
+         updates * 1e9 / wall, 100.0 * cpu * 1e9 / wall,
+         percentile(b->latency, b->nlatency, 500),
+         percentile(b->latency, b->nlatency, 990),
+         percentile(b->latency, b->nlatency, 999),
+         percentile(b->latency, b->nlatency, 1000),
+         seen ? 100.0 * (st.frames - st.late) / seen : 0.0);
+
+  vgb_close(v);
+  free(b->latency);
+  free(b);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned int objects = 64, frames = 600, submits = 1;
+  int flags = 0, all = 0, c, m;
+  enum mode mode = MODE_BATCH;
+
+  while ((c = getopt(argc, argv, "sm:n:f:k:")) != -1)
+    switch (c) {
+    case 's': flags |= VGB_SIM; break;
+    case 'm':
+      all = strcmp(optarg, "all") == 0;
+      for (m = 0; m < MODES && strcmp(optarg, mode_names[m]); m++)
+        ;
+      if (!all && m == MODES) goto usage;
+      mode = m;
+      break;
+    case 'n': objects = strtoul(optarg, NULL, 0); break;
+    case 'f': frames = strtoul(optarg, NULL, 0); break;
+    case 'k': submits = strtoul(optarg, NULL, 0); break;
+    default: goto usage;
+    }
+  if (objects == 0 || objects > VGA_BALL_PALETTE_SIZE || frames == 0 ||
+      submits == 0)
+    goto usage;
+
+  if (!all) {
+    if (run(flags, mode, objects, frames, submits))
+      return 1;
+    printf("\n");
+    return 0;
+  }
+
+  printf("[");
+  for (m = 0; m < MODES; m++) {
+    printf(m ? ",\n " : "");
+    if (run(flags, m, objects, frames, submits))
+      return 1;
+  }
+  printf("]\n");
+  return 0;
+
+ usage:
+  fprintf(stderr, "usage: %s [-s] [-m ioctl|batch|write|dma|all] "
+          "[-n objects (1-256)] [-f frames] [-k submits/frame]\n", argv[0]);
+  return 1;
+}
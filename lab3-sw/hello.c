@@ -8,6 +8,7 @@
 
 #include <stdio.h>
 #include "vga_ball.h"
+#include "libvgaball.h"
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -16,14 +17,19 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <time.h>
+#include <signal.h>
 
-int vga_ball_fd;
+vgb_t *vgb;
+
+/* Palette entries used by the demo */
+#define CIRCLE_PALETTE 1
+#define COLORS_PALETTE 16  /* First of the background colors */
 
 /* Read and print the background color */
 void print_background_color() {
   vga_ball_arg_t vla;
   
-  if (ioctl(vga_ball_fd, VGA_BALL_READ_BACKGROUND, &vla)) {
+  if (vgb_ioctl(vgb, VGA_BALL_READ_BACKGROUND, (unsigned long) &vla)) {
       perror("ioctl(VGA_BALL_READ_BACKGROUND) failed");
       return;
   }  
@@ -32,62 +38,136 @@ void print_background_color() {
     vla.background.red, vla.background.green, vla.background.blue);
 }
 
-/* Set the background color */
-void set_background_color(const vga_ball_color_t *c) {
-  vga_ball_arg_t vla;
-  vla.background = *c;
+/* Load the palette entries starting at first */
+void load_palette(unsigned short first, const vga_ball_color_t *c,
+                  unsigned short count) {
+  vga_ball_palette_t vlp;
 
-  if (ioctl(vga_ball_fd, VGA_BALL_WRITE_BACKGROUND, &vla)) {
-    perror("ioctl(VGA_BALL_SET_BACKGROUND) failed");
-    return;
-  }
+  vlp.first = first;
+  vlp.count = count;
+  vlp.colors = c;
 
-  printf("Background color: %02x %02x %02x\n",
-    vla.background.red, vla.background.green, vla.background.blue);
+  if (vgb_ioctl(vgb, VGA_BALL_LOAD_PALETTE, (unsigned long) &vlp))
+    perror("ioctl(VGA_BALL_LOAD_PALETTE) failed");
+}
+
+/* Point the background at a palette entry: one register write */
+void set_background_index(unsigned char index) {
+  vga_ball_color_index_t vlc;
+
+  vlc.circle = CIRCLE_PALETTE;
+  vlc.background = index;
+
+  if (vgb_ioctl(vgb, VGA_BALL_WRITE_COLOR_INDEX, (unsigned long) &vlc))
+    perror("ioctl(VGA_BALL_WRITE_COLOR_INDEX) failed");
 }
 
 /* Read and print the ball position */
 void print_ball_position() {
   vga_ball_arg_t vla;
   
-  if (ioctl(vga_ball_fd, VGA_BALL_READ_POSITION, &vla)) {
+  if (vgb_ioctl(vgb, VGA_BALL_READ_POSITION, (unsigned long) &vla)) {
       perror("ioctl(VGA_BALL_READ_POSITION) failed");
       return;
   }
   
-  printf("Ball position: x = %d, y = %d\n", vla.position.x, vla.position.y);
+  printf("Ball position: x = %d+%d/16, y = %d+%d/16\n",
+    vla.position.x, vla.position.x_frac, vla.position.y, vla.position.y_frac);
 }
 
-/* Set the ball position */
+/*
+ * Set the ball position; x_pos and y_pos are in 1/16 pixels and are
+ * passed by value, so nothing is copied
+ */
 void set_ball_position(unsigned short x_pos, unsigned short y_pos) {
-  vga_ball_arg_t vla;
-  
-  vla.position.x = x_pos;
-  vla.position.y = y_pos;
-  
-  if (ioctl(vga_ball_fd, VGA_BALL_WRITE_POSITION, &vla)) {
-      perror("ioctl(VGA_BALL_WRITE_POSITION) failed");
+  if (vgb_ioctl(vgb, VGA_BALL_SET_POSITION,
+            VGA_BALL_PACK_XY(x_pos, y_pos))) {
+      perror("ioctl(VGA_BALL_SET_POSITION) failed");
       return;
   }
 
-  printf("Ball position: x = %d, y = %d\n", vla.position.x, vla.position.y);
+  printf("Ball position: x = %d+%d/16, y = %d+%d/16\n",
+    x_pos >> VGA_BALL_FRAC_BITS, x_pos & ((1 << VGA_BALL_FRAC_BITS) - 1),
+    y_pos >> VGA_BALL_FRAC_BITS, y_pos & ((1 << VGA_BALL_FRAC_BITS) - 1));
 }
 
-int main()
-{
-  vga_ball_arg_t vla;
-  int i;
-  static const char filename[] = "/dev/vga_ball";
+#define COLORS 9
 
-  unsigned short ball_pos_x = 256;  /* Initial x position */
-  unsigned short ball_pos_y = 128;  /* Initial y position */
-  short ball_vel_x = 1;              /* X velocity (pixels per frame) */
-  short ball_vel_y = 1;              /* Y velocity (pixels per frame) */
-  
-  /* Screen boundaries */
-  const unsigned short X_MAX = 639;        /* Maximum x coordinate */
-  const unsigned short Y_MAX = 479;         /* Maximum y coordinate */
-  const unsigned short BALL_SIZE = 8;      /* Ball radius in pixels */
+/* Screen boundaries */
+#define X_MAX 639      /* Maximum x coordinate */
+#define Y_MAX 479      /* Maximum y coordinate */
+#define BALL_SIZE 8    /* Ball radius in pixels */
+
+/* Positions and velocities are in 1/16 pixels */
+struct ball {
+  unsigned short x, y;
+  short vel_x, vel_y;   /* Per frame */
+  unsigned long frames; /* Frames left to run; 0 runs forever */
+};
+
+/* Move the ball one frame, changing the background on each bounce */
+int animate(vgb_t *v, unsigned int frame, void *ctx) {
+  struct ball *b = ctx;
+  int rand_color;
+
+  b->x += b->vel_x;
+  b->y += b->vel_y;
+
+  if ((b->x >> VGA_BALL_FRAC_BITS) <= BALL_SIZE +22 ||
+      (b->x >> VGA_BALL_FRAC_BITS) >= X_MAX - BALL_SIZE -22) {
+    b->vel_x = -b->vel_x;
+
+    rand_color = rand() % COLORS;
+    set_background_index(COLORS_PALETTE + rand_color);
+  }
+
+  if ((b->y >> VGA_BALL_FRAC_BITS) <= BALL_SIZE +22 ||
+      (b->y >> VGA_BALL_FRAC_BITS) >= Y_MAX - BALL_SIZE -22) {
+    b->vel_y = -b->vel_y;
+
+    rand_color = rand() % COLORS;
+    set_background_index(COLORS_PALETTE + rand_color);
+  }
+
+  set_ball_position(b->x, b->y);
+  return b->frames && --b->frames == 0;
+}
+
+/* Stop on ^C so the timing report is printed */
+void stop(int sig) {
+  vgb_stop(vgb);
+}
+
+/*
+ * Options:
+ *   -s      use the simulated device
+ *   -r CPU  real-time: SCHED_FIFO, pinned to CPU, memory locked
+ *   -u      pace with usleep(), the old behavior, to compare jitter
+ *   -n N    stop after N frames
+ *   -t FILE record the register traffic to FILE for replay
+ */
+int main(int argc, char *argv[])
+{
+  struct ball ball = {
+    256 << VGA_BALL_FRAC_BITS, 128 << VGA_BALL_FRAC_BITS, /* Initial x, y */
+    16, 16,                                               /* Velocity */
+    0
+  };
+  int flags = 0, rt = 0, cpu = -1, c;
+  const char *trace = NULL;
+
+  while ((c = getopt(argc, argv, "sr:un:t:")) != -1)
+    switch (c) {
+    case 's': flags |= VGB_SIM; break;
+    case 'r': rt = 1; cpu = atoi(optarg); break;
+    case 'u': flags |= VGB_USLEEP; break;
+    case 'n': ball.frames = strtoul(optarg, NULL, 0); break;
+    case 't': trace = optarg; break;
+    default:
+      fprintf(stderr, "usage: %s [-s] [-r cpu] [-u] [-n frames] [-t trace]\n",
+              argv[0]);
+      return 1;
+    }
 
   static const vga_ball_color_t colors[] = {
     // { 0xff, 0x00, 0x00 }, /* Red */
@@ -132,48 +212,41 @@ int main()
     { 0x60, 0xff, 0xff }  /* Cyan */
   };
 
-  #define COLORS 9
-
   printf("VGA ball Userspace program started\n");
 
-  if ((vga_ball_fd = open(filename, O_RDWR)) == -1) {
-    fprintf(stderr, "could not open %s\n", filename);
+  if ((vgb = vgb_open(NULL, flags)) == NULL) {
+    perror("could not open /dev/vga_ball");
     return -1;
   }
 
+  if (trace && vgb_record(vgb, trace))
+    perror(trace);
+
   printf("Initial state: \n");
   print_background_color();
   print_ball_position();
   
+  /* Load every background color once; switching is then one write */
+  load_palette(COLORS_PALETTE, colors, COLORS);
+
   srand(time(NULL));
   int rand_color = rand() % COLORS;
+  set_background_index(COLORS_PALETTE + rand_color);
   print_background_color();
   
   printf("Starting animation\n");
 
-  while (1) {
-    ball_pos_x += ball_vel_x;
-    ball_pos_y += ball_vel_y;
-    
-    if (ball_pos_x <= BALL_SIZE +22 || ball_pos_x >= X_MAX - BALL_SIZE -22) {
-      ball_vel_x = -ball_vel_x;
-      
-      rand_color = rand() % COLORS;
-      set_background_color(&colors[rand_color]);
-    }
-    
-    if (ball_pos_y <= BALL_SIZE +22 || ball_pos_y >= Y_MAX - BALL_SIZE -22) {
-      ball_vel_y = -ball_vel_y;
-      
-      rand_color = rand() % COLORS;
-      set_background_color(&colors[rand_color]);
-    }
-    
-    set_ball_position(ball_pos_x, ball_pos_y);
-    
-    usleep(25000);
-  }
-  
+  if (rt && vgb_set_realtime(vgb, cpu, 50))
+    perror("vgb_set_realtime");
+  signal(SIGINT, stop);
+
+  /* One step per vertical blank */
+  vgb_add_frame(vgb, animate, &ball, 0);
+  if (vgb_run(vgb))
+    perror("vgb_run");
+  vgb_print_stats(vgb);
+  vgb_close(vgb);
+
   printf("VGA BALL Userspace program terminating\n");
   return 0;
 }
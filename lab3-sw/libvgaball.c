@@ -0,0 +1,658 @@
+/*
+ * libvgaball: vsync-locked event loop for vga_ball clients
+ *
+ * On hardware the vertical blank is a read() of /dev/vga_ball, which
+ * returns the driver's vblank count.  The simulated device keeps the
+ * register window in memory and paces itself with a timerfd at the
+ * VGA frame rate, so clients run unchanged without the board.
+ *
+ * In real-time mode the loop runs SCHED_FIFO on one CPU with its
+ * memory locked.  The hardware is still paced by the vblank event; the
+ * simulated device then sleeps to absolute deadlines with
+ * clock_nanosleep() so its period does not drift.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/mman.h>
+#include <sched.h>
+#include "libvgaball.h"
+
+struct frame_cb {
+  vgb_frame_fn fn;
+  void *ctx;
+  long budget_ns;
+};
+
+struct fd_cb {
+  int fd;
+  vgb_fd_fn fn;
+  void *ctx;
+};
+
+/* What starts each frame */
+enum pace {
+  PACE_EVENT,    /* The vblank read(), or the simulated timerfd */
+  PACE_ABSTIME,  /* clock_nanosleep() to the next frame deadline */
+  PACE_USLEEP,   /* usleep() a frame between callbacks */
+};
+
+struct vgb {
+  int fd;               /* Device, or -1 when simulated */
+  int timer;            /* Simulated vertical blank, or -1 */
+  int epoll;
+  int sim;              /* Simulated device */
+  unsigned char *regs;  /* Simulated window, or shadow while recording */
+  FILE *trace;          /* Recording, or NULL */
+  long long trace_last; /* Time of the last record, us */
+  enum pace pace;
+  struct timespec deadline; /* Next frame, for PACE_ABSTIME */
+  unsigned int frame;   /* Last vertical blank seen */
+  int started;          /* frame is valid */
+  volatile int running; /* Cleared by vgb_stop(), maybe from a signal */
+  long long last_wake;
+  long jitter[VGB_JITTER_SAMPLES]; /* Wakeup error, ns; a ring */
+  unsigned long long njitter;
+  struct frame_cb frames[VGB_MAX_CALLBACKS];
+  int nframes;
+  struct fd_cb fds[VGB_MAX_FDS];
+  int nfds;
+  vgb_stats_t stats;
+};
+
+static long long now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Simulated power-up state: what the driver's probe leaves behind */
+static void sim_reset(vgb_t *v) {
+  static const vga_ball_color_t beige = { 0xf9, 0xe4, 0xb7 };
+  unsigned short x = 256 << VGA_BALL_FRAC_BITS, y = 128 << VGA_BALL_FRAC_BITS;
+
+  v->regs[VGA_BALL_REG_BALL_COLOR] = 1;
+  v->regs[VGA_BALL_REG_BG_COLOR] = 0;
+  memcpy(v->regs + VGA_BALL_REG_PALETTE(0), &beige, 3);
+  memset(v->regs + VGA_BALL_REG_PALETTE(1), 0xff, 3);
+  v->regs[VGA_BALL_REG_BALL_X] = x >> 8;
+  v->regs[VGA_BALL_REG_BALL_X + 1] = x & 0xff;
+  v->regs[VGA_BALL_REG_BALL_Y] = y >> 8;
+  v->regs[VGA_BALL_REG_BALL_Y + 1] = y & 0xff;
+}
+
+vgb_t *vgb_open(const char *path, int flags) {
+  struct itimerspec its = {
+    .it_interval = { 0, VGB_FRAME_NS },
+    .it_value = { 0, VGB_FRAME_NS },
+  };
+  struct epoll_event ev = { .events = EPOLLIN };
+  vgb_t *v;
+
+  if ((v = calloc(1, sizeof(*v))) == NULL)
+    return NULL;
+  v->fd = v->timer = -1;
+
+  if (flags & VGB_SIM) {
+    v->sim = 1;
+    if ((v->regs = calloc(1, VGB_SIM_SIZE)) == NULL)
+      goto fail;
+    sim_reset(v);
+    v->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (v->timer == -1 || timerfd_settime(v->timer, 0, &its, NULL))
+      goto fail;
+    ev.data.fd = v->timer;
+  } else {
+    v->fd = open(path ? path : "/dev/vga_ball", O_RDWR | O_CLOEXEC);
+    if (v->fd == -1)
+      goto fail;
+    ev.data.fd = v->fd;
+  }
+
+  if ((v->epoll = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    goto fail;
+  if (flags & VGB_USLEEP)
+    v->pace = PACE_USLEEP;
+  else if (epoll_ctl(v->epoll, EPOLL_CTL_ADD, ev.data.fd, &ev)) {
+    close(v->epoll);
+    goto fail;
+  }
+  return v;
+
+ fail:
+  if (v->fd != -1) close(v->fd);
+  if (v->timer != -1) close(v->timer);
+  free(v->regs);
+  free(v);
+  return NULL;
+}
+
+void vgb_close(vgb_t *v) {
+  if (!v) return;
+  vgb_record_stop(v);
+  close(v->epoll);
+  if (v->fd != -1) close(v->fd);
+  if (v->timer != -1) close(v->timer);
+  free(v->regs);
+  free(v);
+}
+
+int vgb_fd(vgb_t *v) {
+  return v->fd;
+}
+
+const unsigned char *vgb_sim_regs(vgb_t *v) {
+  return v->sim ? v->regs : NULL;
+}
+
+/*
+ * Recording.  A trace is a VGB_TRACE_MAGIC header, then records of a
+ * 32-bit microsecond delta from the previous record, a 16-bit offset
+ * and a 16-bit length, all little endian, followed by the data.
+ * VGB_TRACE_VBLANK as the offset, with no data, marks a frame.
+ */
+
+static void put_le(unsigned char *p, unsigned long x, int bytes) {
+  while (bytes--) {
+    *p++ = x & 0xff;
+    x >>= 8;
+  }
+}
+
+static void trace_record(vgb_t *v, unsigned int offset, const void *data,
+                         unsigned int len) {
+  unsigned char hdr[VGB_TRACE_HDR];
+  long long t = now_ns() / 1000;
+
+  put_le(hdr, t - v->trace_last, 4);
+  put_le(hdr + 4, offset, 2);
+  put_le(hdr + 6, len, 2);
+  v->trace_last = t;
+  fwrite(hdr, sizeof(hdr), 1, v->trace);
+  if (len)
+    fwrite(data, len, 1, v->trace);
+}
+
+static void trace_put(vgb_t *v, unsigned int offset, const void *data,
+                      unsigned int len) {
+  /* Lengths are 16 bits; no single write is that long, but be safe */
+  while (len > 0xffff) {
+    trace_record(v, offset, data, 0xffff);
+    offset += 0xffff;
+    data = (const unsigned char *) data + 0xffff;
+    len -= 0xffff;
+  }
+  trace_record(v, offset, data, len);
+}
+
+int vgb_record(vgb_t *v, const char *path) {
+  if (v->trace)
+    vgb_record_stop(v);
+  if (!v->regs) {
+    /* Hardware: shadow the state the driver's probe leaves, from now on */
+    if ((v->regs = calloc(1, VGB_SIM_SIZE)) == NULL)
+      return -1;
+    sim_reset(v);
+  }
+  if ((v->trace = fopen(path, "wb")) == NULL)
+    return -1;
+  fwrite(VGB_TRACE_MAGIC, 4, 1, v->trace);
+  v->trace_last = now_ns() / 1000;
+  return 0;
+}
+
+int vgb_record_stop(vgb_t *v) {
+  int r = 0;
+
+  if (v->trace) {
+    r = fclose(v->trace);
+    v->trace = NULL;
+  }
+  return r;
+}
+
+/*
+ * The simulated device.  Every register write goes through put(), so
+ * the same code also turns hardware ioctls into trace records.
+ */
+
+static void put(vgb_t *v, unsigned int offset, const void *data,
+                unsigned int len) {
+  memcpy(v->regs + offset, data, len);
+  if (v->trace)
+    trace_put(v, offset, data, len);
+}
+
+static void put_byte(vgb_t *v, unsigned int offset, unsigned char b) {
+  put(v, offset, &b, 1);
+}
+
+static void put_short(vgb_t *v, unsigned int offset, unsigned short x) {
+  unsigned char b[2] = { x >> 8, x & 0xff };
+
+  put(v, offset, b, 2);
+}
+
+static void sim_position(vgb_t *v, unsigned short x, unsigned short y) {
+  unsigned char b[4] = { x >> 8, x & 0xff, y >> 8, y & 0xff };
+
+  put(v, VGA_BALL_REG_BALL_X, b, 4);
+}
+
+static void sim_color(vgb_t *v, unsigned int i, const vga_ball_color_t *c) {
+  unsigned char b[3] = { c->red, c->green, c->blue };
+
+  put(v, VGA_BALL_REG_PALETTE(i), b, 3);
+}
+
+static int sim_block(vgb_t *v, unsigned int base, unsigned int size,
+                     const vga_ball_block_t *b) {
+  if (b->offset + b->length > size) {
+    errno = EINVAL;
+    return -1;
+  }
+  put(v, base + b->offset, b->data, b->length);
+  return 0;
+}
+
+static void sim_tile_ctrl(vgb_t *v, int bit, int on) {
+  unsigned char ctrl = v->regs[VGA_BALL_REG_TILE_CTRL];
+
+  put_byte(v, VGA_BALL_REG_TILE_CTRL, on ? ctrl | bit : ctrl & ~bit);
+}
+
+static int sim_ioctl(vgb_t *v, unsigned long cmd, unsigned long arg) {
+  unsigned char *r = v->regs;
+  vga_ball_arg_t *vla = (vga_ball_arg_t *) arg;
+  const vga_ball_tiles_t *tiles = (const vga_ball_tiles_t *) arg;
+  const vga_ball_scroll_t *scroll = (const vga_ball_scroll_t *) arg;
+  const vga_ball_palette_t *pal = (const vga_ball_palette_t *) arg;
+  const vga_ball_color_index_t *ci = (const vga_ball_color_index_t *) arg;
+  const vga_ball_dma_t *dma = (const vga_ball_dma_t *) arg;
+  const unsigned char *p;
+  vga_ball_color_t c;
+  unsigned int i, x, y, total = 0;
+
+  switch (cmd) {
+  case VGA_BALL_WRITE_BACKGROUND:
+    sim_color(v, r[VGA_BALL_REG_BG_COLOR], &vla->background);
+    return 0;
+
+  case VGA_BALL_READ_BACKGROUND:
+    p = r + VGA_BALL_REG_PALETTE(r[VGA_BALL_REG_BG_COLOR]);
+    vla->background.red = p[0];
+    vla->background.green = p[1];
+    vla->background.blue = p[2];
+    return 0;
+
+  case VGA_BALL_WRITE_POSITION:
+    sim_position(v,
+      (vla->position.x << VGA_BALL_FRAC_BITS) | (vla->position.x_frac & 0xf),
+      (vla->position.y << VGA_BALL_FRAC_BITS) | (vla->position.y_frac & 0xf));
+    return 0;
+
+  case VGA_BALL_READ_POSITION:
+    x = r[VGA_BALL_REG_BALL_X] << 8 | r[VGA_BALL_REG_BALL_X + 1];
+    y = r[VGA_BALL_REG_BALL_Y] << 8 | r[VGA_BALL_REG_BALL_Y + 1];
+    vla->position.x = x >> VGA_BALL_FRAC_BITS;
+    vla->position.x_frac = x & 0xf;
+    vla->position.y = y >> VGA_BALL_FRAC_BITS;
+    vla->position.y_frac = y & 0xf;
+    return 0;
+
+  case VGA_BALL_WRITE_TILES:
+    put_byte(v, VGA_BALL_REG_TILE_PALETTE, tiles->palette & 0x3f);
+    sim_tile_ctrl(v, VGA_BALL_TILE_CTRL_ENABLE, tiles->enable);
+    return 0;
+
+  case VGA_BALL_WRITE_NAMES:
+    return sim_block(v, VGA_BALL_NAME_BASE, VGA_BALL_NAME_SIZE,
+                     (const vga_ball_block_t *) arg);
+
+  case VGA_BALL_WRITE_PATTERNS:
+    return sim_block(v, VGA_BALL_PATTERN_BASE, VGA_BALL_PATTERN_SIZE,
+                     (const vga_ball_block_t *) arg);
+
+  case VGA_BALL_WRITE_LINE_SCROLL:
+    return sim_block(v, VGA_BALL_LINE_SCROLL_BASE, VGA_BALL_LINE_SCROLL_SIZE,
+                     (const vga_ball_block_t *) arg);
+
+  case VGA_BALL_WRITE_SCROLL:
+    put_short(v, VGA_BALL_REG_SCROLL_X, scroll->x & 0x3ff);
+    put_short(v, VGA_BALL_REG_SCROLL_Y, scroll->y & 0x1ff);
+    sim_tile_ctrl(v, VGA_BALL_TILE_CTRL_LINE_SCROLL, scroll->line_scroll);
+    return 0;
+
+  case VGA_BALL_LOAD_PALETTE:
+    if (pal->first + pal->count > VGA_BALL_PALETTE_SIZE)
+      break;
+    for (i = 0; i < pal->count; i++)
+      sim_color(v, pal->first + i, &pal->colors[i]);
+    return 0;
+
+  case VGA_BALL_WRITE_COLOR_INDEX:
+    put_byte(v, VGA_BALL_REG_BALL_COLOR, ci->circle);
+    put_byte(v, VGA_BALL_REG_BG_COLOR, ci->background);
+    return 0;
+
+  case VGA_BALL_DMA_UPLOAD:
+    if (dma->count == 0 || dma->count > VGA_BALL_DMA_BLOCKS)
+      break;
+    for (i = 0; i < dma->count; i++) {
+      const vga_ball_block_t *b = &dma->blocks[i];
+      if (b->offset < VGA_BALL_PALETTE_BASE ||
+          b->offset + b->length > VGA_BALL_MEM_END ||
+          (total += b->length) > VGA_BALL_DMA_MAX)
+        goto inval;
+    }
+    for (i = 0; i < dma->count; i++)
+      put(v, dma->blocks[i].offset, dma->blocks[i].data,
+          dma->blocks[i].length);
+    return 0;
+
+  case VGA_BALL_WRITE_BLOCKS:
+    if (dma->count > VGA_BALL_DMA_BLOCKS)
+      break;
+    for (i = 0; i < dma->count; i++)
+      if (dma->blocks[i].offset + dma->blocks[i].length > VGB_SIM_SIZE ||
+          VGA_BALL_HITS_CTRL(dma->blocks[i].offset, dma->blocks[i].length))
+        goto inval;
+    for (i = 0; i < dma->count; i++)
+      put(v, dma->blocks[i].offset, dma->blocks[i].data,
+          dma->blocks[i].length);
+    return 0;
+
+  case VGA_BALL_SET_POSITION:
+    sim_position(v, arg >> 16, arg & 0xffff);
+    return 0;
+
+  case VGA_BALL_SET_BACKGROUND:
+    c.red = arg >> 24;
+    c.green = arg >> 16;
+    c.blue = arg >> 8;
+    sim_color(v, r[VGA_BALL_REG_BG_COLOR], &c);
+    return 0;
+  }
+
+ inval:
+  errno = EINVAL;
+  return -1;
+}
+
+/*
+ * On hardware, once a recording has made the shadow window, each
+ * successful write ioctl is replayed on it to learn the registers it
+ * wrote; that goes on after the recording stops, so a later one starts
+ * from the registers as they are
+ */
+int vgb_ioctl(vgb_t *v, unsigned long cmd, unsigned long arg) {
+  int r;
+
+  if (v->sim)
+    return sim_ioctl(v, cmd, arg);
+  r = ioctl(v->fd, cmd, arg);
+  if (r == 0 && v->regs && !(_IOC_DIR(cmd) & _IOC_READ))
+    sim_ioctl(v, cmd, arg);
+  return r;
+}
+
+ssize_t vgb_pwrite(vgb_t *v, const void *buf, size_t count, off_t offset) {
+  ssize_t n;
+
+  if (!v->sim) {
+    n = pwrite(v->fd, buf, count, offset);
+    if (n > 0 && v->regs && offset + n <= VGB_SIM_SIZE)
+      put(v, offset, buf, n);
+    return n;
+  }
+
+  if (offset < 0 || offset >= VGB_SIM_SIZE) {
+    if (!count) return 0;
+    errno = ENOSPC;
+    return -1;
+  }
+  if (count > (size_t)(VGB_SIM_SIZE - offset))
+    count = VGB_SIM_SIZE - offset;
+  if (VGA_BALL_HITS_CTRL((size_t) offset, count)) {
+    errno = EINVAL;
+    return -1;
+  }
+  put(v, offset, buf, count);
+  return count;
+}
+
+/*
+ * The loop
+ */
+
+int vgb_add_frame(vgb_t *v, vgb_frame_fn fn, void *ctx, long budget_ns) {
+  if (v->nframes == VGB_MAX_CALLBACKS) {
+    errno = ENOSPC;
+    return -1;
+  }
+  v->frames[v->nframes].fn = fn;
+  v->frames[v->nframes].ctx = ctx;
+  v->frames[v->nframes].budget_ns = budget_ns > 0 ? budget_ns : VGB_FRAME_NS;
+  v->nframes++;
+  return 0;
+}
+
+int vgb_add_fd(vgb_t *v, int fd, unsigned int events, vgb_fd_fn fn,
+               void *ctx) {
+  struct epoll_event ev = { .events = events, .data.fd = fd };
+
+  if (v->nfds == VGB_MAX_FDS) {
+    errno = ENOSPC;
+    return -1;
+  }
+  if (epoll_ctl(v->epoll, EPOLL_CTL_ADD, fd, &ev))
+    return -1;
+  v->fds[v->nfds].fd = fd;
+  v->fds[v->nfds].fn = fn;
+  v->fds[v->nfds].ctx = ctx;
+  v->nfds++;
+  return 0;
+}
+
+/*
+ * Real-time mode: pin to cpu (unless negative), run SCHED_FIFO at
+ * priority and lock all memory, touching some stack now so the loop
+ * does not fault later.  Needs CAP_SYS_NICE and CAP_IPC_LOCK.
+ */
+int vgb_set_realtime(vgb_t *v, int cpu, int priority) {
+  struct sched_param sp = { .sched_priority = priority };
+  volatile char stack[VGB_PREFAULT_STACK];
+  cpu_set_t cpus;
+
+  if (cpu >= 0) {
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus))
+      return -1;
+  }
+  if (sched_setscheduler(0, SCHED_FIFO, &sp))
+    return -1;
+  if (mlockall(MCL_CURRENT | MCL_FUTURE))
+    return -1;
+  memset((char *) stack, 0, sizeof(stack));
+
+  if (v->sim && v->pace == PACE_EVENT) {
+    epoll_ctl(v->epoll, EPOLL_CTL_DEL, v->timer, NULL);
+    v->pace = PACE_ABSTIME;
+  }
+  return 0;
+}
+
+/* Sleep until the next frame of a sleeping pace */
+static unsigned int sleep_frame(vgb_t *v) {
+  struct timespec now;
+  long long late;
+  unsigned int n = 1;
+
+  if (v->pace == PACE_USLEEP) {
+    usleep(VGB_FRAME_NS / 1000);
+    return v->frame + 1;
+  }
+
+  if (!v->started) {
+    clock_gettime(CLOCK_MONOTONIC, &v->deadline);
+    v->deadline.tv_nsec += VGB_FRAME_NS;
+  }
+  while (v->deadline.tv_nsec >= 1000000000L) {
+    v->deadline.tv_nsec -= 1000000000L;
+    v->deadline.tv_sec++;
+  }
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &v->deadline,
+                         NULL) == EINTR && v->running)
+    ;
+
+  /* Frames whose deadlines have also passed are skipped */
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  late = (now.tv_sec - v->deadline.tv_sec) * 1000000000LL +
+    now.tv_nsec - v->deadline.tv_nsec;
+  if (late > 0)
+    n += late / VGB_FRAME_NS;
+  v->deadline.tv_nsec += (long long) n * VGB_FRAME_NS % 1000000000L;
+  v->deadline.tv_sec += (long long) n * VGB_FRAME_NS / 1000000000L;
+  return v->frame + n;
+}
+
+/* Read the vertical blank count; 0 if there is no new one yet */
+static int next_vblank(vgb_t *v, unsigned int *frame) {
+  unsigned long long expirations;
+  unsigned int seq;
+
+  if (v->sim) {
+    if (read(v->timer, &expirations, sizeof(expirations)) != sizeof(expirations))
+      return errno == EAGAIN ? 0 : -1;
+    *frame = v->frame + expirations;
+    return 1;
+  }
+  if (read(v->fd, &seq, sizeof(seq)) != sizeof(seq))
+    return -1;
+  *frame = seq;
+  return 1;
+}
+
+/* Run every frame callback and charge the time against their budgets */
+static int run_frame(vgb_t *v, unsigned int frame) {
+  long long start, t, used, err;
+  int i, late = 0, stop = 0;
+
+  /* Wakeup jitter: how far this wakeup is from a whole frame period */
+  start = t = now_ns();
+  if (v->started) {
+    err = start - v->last_wake - (long long)(frame - v->frame) * VGB_FRAME_NS;
+    v->jitter[v->njitter++ % VGB_JITTER_SAMPLES] = err < 0 ? -err : err;
+  }
+  v->last_wake = start;
+
+  if (v->started && frame - v->frame > 1)
+    v->stats.skipped += frame - v->frame - 1;
+  v->frame = frame;
+  v->started = 1;
+  if (v->trace)
+    trace_record(v, VGB_TRACE_VBLANK, NULL, 0);
+
+  for (i = 0; i < v->nframes && !stop; i++) {
+    stop = v->frames[i].fn(v, frame, v->frames[i].ctx);
+    used = now_ns() - t;
+    t += used;
+    if (used > v->frames[i].budget_ns)
+      late = 1;
+  }
+
+  used = t - start;
+  v->stats.frames++;
+  v->stats.busy_ns += used;
+  if ((unsigned long long) used > v->stats.max_ns)
+    v->stats.max_ns = used;
+  if (late || used > VGB_FRAME_NS)
+    v->stats.late++;
+  return stop;
+}
+
+int vgb_run(vgb_t *v) {
+  struct epoll_event events[VGB_MAX_FDS + 1];
+  unsigned int frame;
+  int n, i, j, r;
+
+  v->running = 1;
+  while (v->running) {
+    /* A sleeping pace only polls the other descriptors */
+    if (v->pace != PACE_EVENT && run_frame(v, sleep_frame(v)))
+      break;
+    n = epoll_wait(v->epoll, events, VGB_MAX_FDS + 1,
+                   v->pace == PACE_EVENT ? -1 : 0);
+    if (n == -1) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    for (i = 0; i < n && v->running; i++) {
+      int fd = events[i].data.fd;
+
+      if (fd == v->fd || fd == v->timer) {
+        if ((r = next_vblank(v, &frame)) == -1)
+          return -1;
+        if (r && run_frame(v, frame))
+          v->running = 0;
+        continue;
+      }
+      for (j = 0; j < v->nfds; j++)
+        if (v->fds[j].fd == fd &&
+            v->fds[j].fn(v, fd, events[i].events, v->fds[j].ctx))
+          v->running = 0;
+    }
+  }
+  return 0;
+}
+
+void vgb_stop(vgb_t *v) {
+  v->running = 0;
+}
+
+void vgb_get_stats(vgb_t *v, vgb_stats_t *stats) {
+  *stats = v->stats;
+}
+
+static int cmp_long(const void *a, const void *b) {
+  long x = *(const long *) a, y = *(const long *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+/* Wakeup jitter of recent frames at a permille (500 median, 1000 max) */
+long vgb_jitter_ns(vgb_t *v, int permille) {
+  size_t n = v->njitter < VGB_JITTER_SAMPLES ? v->njitter : VGB_JITTER_SAMPLES;
+  long *sorted, r;
+
+  if (n == 0 || (sorted = malloc(n * sizeof(long))) == NULL)
+    return 0;
+  memcpy(sorted, v->jitter, n * sizeof(long));
+  qsort(sorted, n, sizeof(long), cmp_long);
+  r = sorted[(n - 1) * permille / 1000];
+  free(sorted);
+  return r;
+}
+
+void vgb_print_stats(vgb_t *v) {
+  vgb_stats_t *s = &v->stats;
+
+  fprintf(stderr, "frames %llu, skipped %llu, late %llu, "
+          "callbacks avg %llu us max %llu us\n",
+          s->frames, s->skipped, s->late,
+          s->frames ? s->busy_ns / s->frames / 1000 : 0, s->max_ns / 1000);
+  fprintf(stderr, "wakeup jitter p50 %ld us, p99 %ld us, max %ld us\n",
+          vgb_jitter_ns(v, 500) / 1000, vgb_jitter_ns(v, 990) / 1000,
+          vgb_jitter_ns(v, 1000) / 1000);
+}
@@ -0,0 +1,119 @@
+/*
+ * libvgaball: open the vga_ball device, or a simulated one, and run
+ * per-frame callbacks locked to its vertical blank
+ *
+ * A client registers callbacks and calls vgb_run().  The loop waits in
+ * epoll for the next vertical blank (a read() of /dev/vga_ball, or a
+ * timer for the simulated device), runs every callback once and times
+ * it against its budget.  Frames the loop did not see are counted as
+ * skipped.  Other descriptors, such as input, can share the loop.
+ */
+
+#ifndef _LIBVGABALL_H
+#define _LIBVGABALL_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "vga_ball.h"
+
+/* 525 lines of 1600 50 MHz clocks */
+#define VGB_FRAME_NS 16800000L
+
+#define VGB_MAX_CALLBACKS 8
+#define VGB_MAX_FDS       8
+
+/* Size of the simulated register window */
+#define VGB_SIM_SIZE      16384
+
+/* Frames of wakeup jitter kept for the report */
+#define VGB_JITTER_SAMPLES 4096
+
+/* Stack touched before the loop in real-time mode */
+#define VGB_PREFAULT_STACK (64 * 1024)
+
+/* Register traces written by vgb_record() */
+#define VGB_TRACE_MAGIC  "VGT1"
+#define VGB_TRACE_HDR    8       /* Delta us 32, offset 16, length 16 */
+#define VGB_TRACE_VBLANK 0xffff  /* Offset of a frame marker */
+
+/* Flags for vgb_open() */
+#define VGB_SIM    0x01  /* Simulated device: no hardware needed */
+#define VGB_USLEEP 0x02  /* Pace with usleep(), as hello once did */
+
+typedef struct vgb vgb_t;
+
+/*
+ * Called once per frame with the vertical blank count.  Returning
+ * nonzero stops the loop.
+ */
+typedef int (*vgb_frame_fn)(vgb_t *v, unsigned int frame, void *ctx);
+
+/* Called when fd has any of the events it was added with */
+typedef int (*vgb_fd_fn)(vgb_t *v, int fd, unsigned int events, void *ctx);
+
+typedef struct {
+  unsigned long long frames;   /* Frames the callbacks ran in */
+  unsigned long long skipped;  /* Vertical blanks the loop missed */
+  unsigned long long late;     /* Frames whose callbacks overran budget */
+  unsigned long long busy_ns;  /* Total time in callbacks */
+  unsigned long long max_ns;   /* Longest frame of callbacks */
+} vgb_stats_t;
+
+/* path NULL means /dev/vga_ball; ignored with VGB_SIM */
+vgb_t *vgb_open(const char *path, int flags);
+void vgb_close(vgb_t *v);
+
+/* The device descriptor, or -1 for the simulated device */
+int vgb_fd(vgb_t *v);
+
+/* The simulated register window, or NULL for hardware */
+const unsigned char *vgb_sim_regs(vgb_t *v);
+
+/*
+ * The vga_ball.h ioctls and write() interface.  The simulated device
+ * applies them to its register window.
+ */
+int vgb_ioctl(vgb_t *v, unsigned long cmd, unsigned long arg);
+ssize_t vgb_pwrite(vgb_t *v, const void *buf, size_t count, off_t offset);
+
+/*
+ * Record every register write, and each frame the loop runs, to a
+ * trace file at path; replay plays it back.  On hardware the ioctls
+ * are translated to registers on a shadow of the window, which starts
+ * from the driver's power-up state at the first recording and is kept
+ * up to date from then on.
+ */
+int vgb_record(vgb_t *v, const char *path);
+int vgb_record_stop(vgb_t *v);
+
+/*
+ * Add a per-frame callback.  budget_ns is its share of the frame;
+ * 0 means the whole frame.
+ */
+int vgb_add_frame(vgb_t *v, vgb_frame_fn fn, void *ctx, long budget_ns);
+
+/* Add a descriptor to the loop; events are EPOLLIN etc. */
+int vgb_add_fd(vgb_t *v, int fd, unsigned int events, vgb_fd_fn fn,
+               void *ctx);
+
+/*
+ * Real-time mode: pin to cpu (-1 for any), SCHED_FIFO at priority,
+ * memory locked.  Best on a core kept free with isolcpus=.  -1 and
+ * errno if not permitted.
+ */
+int vgb_set_realtime(vgb_t *v, int cpu, int priority);
+
+/* Run until a callback returns nonzero or vgb_stop(); -1 on error */
+int vgb_run(vgb_t *v);
+void vgb_stop(vgb_t *v);
+
+void vgb_get_stats(vgb_t *v, vgb_stats_t *stats);
+void vgb_print_stats(vgb_t *v);
+
+/*
+ * Error of recent wakeups against whole frame periods, in ns, at a
+ * permille: 500 is the median, 1000 the maximum
+ */
+long vgb_jitter_ns(vgb_t *v, int permille);
+
+#endif
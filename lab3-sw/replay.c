@@ -0,0 +1,128 @@
+/*
+ * Replay a register trace recorded by vgb_record()
+ *
+ * replay [-s] [-f] [-c] trace
+ *
+ *   -s  replay on the simulated device instead of /dev/vga_ball
+ *   -f  as fast as possible instead of at the recorded times
+ *   -c  with -s, print a checksum of the register window at each frame
+ *
+ * Prints a JSON summary; with -s it includes a checksum of the final
+ * register window, so two versions can be compared on the same trace.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "vga_ball.h"
+#include "libvgaball.h"
+
+static unsigned long get_le(const unsigned char *p, int bytes) {
+  unsigned long x = 0;
+
+  while (bytes--)
+    x = x << 8 | p[bytes];
+  return x;
+}
+
+/* FNV-1a over the registers and memories */
+static unsigned int checksum(const unsigned char *regs) {
+  unsigned int h = 2166136261u;
+  int i;
+
+  for (i = 0; i < VGA_BALL_MEM_END; i++)
+    h = (h ^ regs[i]) * 16777619u;
+  return h;
+}
+
+static long long now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned char hdr[VGB_TRACE_HDR], data[65536];
+  unsigned long long records = 0, bytes = 0, frames = 0, errors = 0;
+  int flags = 0, fast = 0, sums = 0, c;
+  unsigned int offset, len;
+  struct timespec due;
+  long long start, t_us = 0, wall;
+  const unsigned char *regs;
+  FILE *f;
+  vgb_t *v;
+
+  while ((c = getopt(argc, argv, "sfc")) != -1)
+    switch (c) {
+    case 's': flags |= VGB_SIM; break;
+    case 'f': fast = 1; break;
+    case 'c': sums = 1; break;
+    default: goto usage;
+    }
+  if (optind != argc - 1)
+    goto usage;
+
+  if ((f = fopen(argv[optind], "rb")) == NULL) {
+    perror(argv[optind]);
+    return 1;
+  }
+  if (fread(hdr, 4, 1, f) != 1 || memcmp(hdr, VGB_TRACE_MAGIC, 4)) {
+    fprintf(stderr, "%s: not a vga_ball trace\n", argv[optind]);
+    return 1;
+  }
+  if ((v = vgb_open(NULL, flags)) == NULL) {
+    perror("could not open /dev/vga_ball");
+    return 1;
+  }
+  regs = vgb_sim_regs(v);
+
+  start = now_ns();
+  while (fread(hdr, sizeof(hdr), 1, f) == 1) {
+    t_us += get_le(hdr, 4);
+    offset = get_le(hdr + 4, 2);
+    len = get_le(hdr + 6, 2);
+    if (len && fread(data, len, 1, f) != 1) {
+      fprintf(stderr, "%s: truncated\n", argv[optind]);
+      break;
+    }
+
+    if (!fast) {
+      due.tv_sec = (start + t_us * 1000) / 1000000000LL;
+      due.tv_nsec = (start + t_us * 1000) % 1000000000LL;
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+    }
+
+    if (offset == VGB_TRACE_VBLANK) {
+      if (sums && regs)
+        printf("frame %llu %08x\n", frames, checksum(regs));
+      frames++;
+      continue;
+    }
+    if (vgb_pwrite(v, data, len, offset) != (ssize_t) len)
+      errors++;
+    records++;
+    bytes += len;
+  }
+  wall = now_ns() - start;
+
+  printf("{\"device\": \"%s\", \"speed\": \"%s\", \"records\": %llu, "
+         "\"bytes\": %llu, \"frames\": %llu, \"errors\": %llu, "
+         "\"seconds\": %.3f, \"bytes_per_sec\": %.1f",
+         regs ? "sim" : "hw", fast ? "max" : "recorded", records, bytes,
+         frames, errors, wall / 1e9, wall ? bytes * 1e9 / wall : 0.0);
+  if (regs)
+    printf(", \"checksum\": \"%08x\"", checksum(regs));
+  printf("}\n");
+
+  fclose(f);
+  vgb_close(v);
+  return errors != 0;
+
+ usage:
+  fprintf(stderr, "usage: %s [-s] [-f] [-c] trace\n", argv[0]);
+  return 1;
+}
@@ -0,0 +1,198 @@
+/*
+ * Scene layer: dirty tracking and coalesced register writes
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "scene.h"
+
+struct scene {
+  vgb_t *v;
+  unsigned char shadow[SCENE_SIZE];
+  unsigned char known[SCENE_SIZE / 8];  /* Byte has been set */
+  unsigned char dirty[SCENE_SIZE / 8];  /* Byte changed since commit */
+  unsigned int lo, hi;                  /* Dirty bytes lie in [lo, hi) */
+  scene_stats_t stats;
+};
+
+#define BIT_TEST(map, i) ((map)[(i) / 8] & (1 << ((i) % 8)))
+#define BIT_SET(map, i)  ((map)[(i) / 8] |= 1 << ((i) % 8))
+
+scene_t *scene_new(vgb_t *v) {
+  scene_t *s = calloc(1, sizeof(*s));
+
+  if (s) {
+    s->v = v;
+    s->lo = SCENE_SIZE;
+  }
+  return s;
+}
+
+void scene_free(scene_t *s) {
+  free(s);
+}
+
+int scene_set_bytes(scene_t *s, unsigned int offset, const void *data,
+                    unsigned int len) {
+  const unsigned char *p = data;
+  unsigned int i, a;
+
+  if (offset + len > SCENE_SIZE || VGA_BALL_HITS_CTRL(offset, len)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  for (i = 0; i < len; i++) {
+    a = offset + i;
+    if (BIT_TEST(s->known, a) && s->shadow[a] == p[i])
+      continue;
+    s->shadow[a] = p[i];
+    BIT_SET(s->known, a);
+    BIT_SET(s->dirty, a);
+    if (a < s->lo) s->lo = a;
+    if (a + 1 > s->hi) s->hi = a + 1;
+  }
+  return 0;
+}
+
+static void set_byte(scene_t *s, unsigned int offset, unsigned char b) {
+  scene_set_bytes(s, offset, &b, 1);
+}
+
+static void set_short(scene_t *s, unsigned int offset, unsigned short x) {
+  unsigned char b[2] = { x >> 8, x & 0xff };
+
+  scene_set_bytes(s, offset, b, 2);
+}
+
+void scene_set_ball(scene_t *s, unsigned short x, unsigned short y) {
+  set_short(s, VGA_BALL_REG_BALL_X, x);
+  set_short(s, VGA_BALL_REG_BALL_Y, y);
+}
+
+void scene_set_radius(scene_t *s, unsigned char radius) {
+  set_byte(s, VGA_BALL_REG_BALL_RADIUS, radius);
+}
+
+void scene_set_ball_color(scene_t *s, unsigned char index) {
+  set_byte(s, VGA_BALL_REG_BALL_COLOR, index);
+}
+
+void scene_set_background(scene_t *s, unsigned char index) {
+  set_byte(s, VGA_BALL_REG_BG_COLOR, index);
+}
+
+void scene_set_color(scene_t *s, unsigned char index,
+                     const vga_ball_color_t *c) {
+  /* The unused fourth byte is set too, so adjacent entries join */
+  unsigned char b[4] = { c->red, c->green, c->blue, 0 };
+
+  scene_set_bytes(s, VGA_BALL_REG_PALETTE(index), b, 4);
+}
+
+/* TILE_CTRL holds a bit from the tile and a bit from the scroll setting */
+static void set_tile_ctrl(scene_t *s, unsigned char bit, int on) {
+  unsigned char ctrl = BIT_TEST(s->known, VGA_BALL_REG_TILE_CTRL) ?
+    s->shadow[VGA_BALL_REG_TILE_CTRL] : 0;
+
+  set_byte(s, VGA_BALL_REG_TILE_CTRL, on ? ctrl | bit : ctrl & ~bit);
+}
+
+void scene_set_tiles(scene_t *s, int enable, unsigned char palette) {
+  set_byte(s, VGA_BALL_REG_TILE_PALETTE, palette & 0x3f);
+  set_tile_ctrl(s, VGA_BALL_TILE_CTRL_ENABLE, enable);
+}
+
+void scene_set_scroll(scene_t *s, unsigned short x, unsigned short y,
+                      int line_scroll) {
+  set_short(s, VGA_BALL_REG_SCROLL_X, x & 0x3ff);
+  set_short(s, VGA_BALL_REG_SCROLL_Y, y & 0x1ff);
+  set_tile_ctrl(s, VGA_BALL_TILE_CTRL_LINE_SCROLL, line_scroll);
+}
+
+void scene_set_name(scene_t *s, unsigned int col, unsigned int row,
+                    unsigned char tile) {
+  if (col < VGA_BALL_NAME_COLS && row < VGA_BALL_NAME_ROWS)
+    set_byte(s, VGA_BALL_NAME_BASE + row * VGA_BALL_NAME_COLS + col, tile);
+}
+
+void scene_set_pattern(scene_t *s, unsigned char tile,
+                       const unsigned char pattern[16]) {
+  scene_set_bytes(s, VGA_BALL_PATTERN_BASE + 16 * tile, pattern, 16);
+}
+
+void scene_set_line_scroll(scene_t *s, unsigned int line, unsigned short x) {
+  if (line < VGA_BALL_LINE_SCROLL_SIZE / 2)
+    set_short(s, VGA_BALL_LINE_SCROLL_BASE + 2 * line, x & 0x3ff);
+}
+
+static int flush(scene_t *s, vga_ball_block_t *blocks, unsigned int n) {
+  vga_ball_dma_t list = { n, blocks };
+
+  if (n == 0)
+    return 0;
+  s->stats.writes++;
+  return vgb_ioctl(s->v, VGA_BALL_WRITE_BLOCKS, (unsigned long) &list);
+}
+
+/* The first dirty byte in [i, hi), or hi; skips clean bitmap bytes */
+static unsigned int next_dirty(scene_t *s, unsigned int i) {
+  while (i < s->hi) {
+    if (i % 8 == 0 && s->dirty[i / 8] == 0) {
+      i += 8;
+      continue;
+    }
+    if (BIT_TEST(s->dirty, i))
+      return i;
+    i++;
+  }
+  return s->hi;
+}
+
+int scene_commit(scene_t *s) {
+  vga_ball_block_t blocks[VGA_BALL_DMA_BLOCKS];
+  unsigned int n = 0, start, end, next, sent = 0, i;
+
+  for (start = next_dirty(s, s->lo); start < s->hi; start = next) {
+    /* Extend over dirty bytes and over short gaps of known ones */
+    end = start + 1;
+    for (;;) {
+      while (end < s->hi && BIT_TEST(s->dirty, end))
+        end++;
+      for (next = end; next < s->hi && next - end < SCENE_MERGE_GAP &&
+             !BIT_TEST(s->dirty, next) && BIT_TEST(s->known, next); next++)
+        ;
+      if (next < s->hi && BIT_TEST(s->dirty, next))
+        end = next;
+      else
+        break;
+    }
+    next = next_dirty(s, end);
+
+    blocks[n].offset = start;
+    blocks[n].length = end - start;
+    blocks[n].data = s->shadow + start;
+    sent += end - start;
+    s->stats.runs++;
+    if (++n == VGA_BALL_DMA_BLOCKS) {
+      if (flush(s, blocks, n))
+        return -1;
+      n = 0;
+    }
+  }
+  if (flush(s, blocks, n))
+    return -1;
+
+  for (i = s->lo / 8; i < (s->hi + 7) / 8; i++)
+    s->dirty[i] = 0;
+  s->lo = SCENE_SIZE;
+  s->hi = 0;
+  s->stats.commits++;
+  s->stats.bytes += sent;
+  return sent;
+}
+
+void scene_get_stats(scene_t *s, scene_stats_t *stats) {
+  *stats = s->stats;
+}
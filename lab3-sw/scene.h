@@ -0,0 +1,64 @@
+/*
+ * Scene layer over the vga_ball register window
+ *
+ * The scene keeps a shadow of every register and memory byte it has
+ * set.  Setters change only the shadow and mark the bytes that really
+ * changed as dirty.  scene_commit() turns the dirty bytes into runs,
+ * joins runs separated by a few unchanged bytes, and sends them with
+ * one VGA_BALL_WRITE_BLOCKS per VGA_BALL_DMA_BLOCKS runs.  Bus traffic
+ * therefore follows what changed, not how big the scene is.
+ *
+ * Bytes the scene has never set are never sent.  The DMA and interrupt
+ * registers (0x20-0x25) cannot be set.
+ */
+
+#ifndef _SCENE_H
+#define _SCENE_H
+
+#include "vga_ball.h"
+#include "libvgaball.h"
+
+/* Bytes covered: registers, palette and tile memories */
+#define SCENE_SIZE VGA_BALL_MEM_END
+
+/* Two runs closer than this are sent as one, resending the gap */
+#define SCENE_MERGE_GAP 8
+
+typedef struct scene scene_t;
+
+typedef struct {
+  unsigned long long commits;
+  unsigned long long writes;  /* WRITE_BLOCKS calls */
+  unsigned long long runs;
+  unsigned long long bytes;   /* Including merged gaps */
+} scene_stats_t;
+
+scene_t *scene_new(vgb_t *v);
+void scene_free(scene_t *s);
+
+/* Set len bytes at a register offset; -1 (EINVAL) outside the scene */
+int scene_set_bytes(scene_t *s, unsigned int offset, const void *data,
+                    unsigned int len);
+
+/* Circle center in 1/16 pixels */
+void scene_set_ball(scene_t *s, unsigned short x, unsigned short y);
+void scene_set_radius(scene_t *s, unsigned char radius);
+void scene_set_ball_color(scene_t *s, unsigned char index);
+void scene_set_background(scene_t *s, unsigned char index);
+void scene_set_color(scene_t *s, unsigned char index,
+                     const vga_ball_color_t *c);
+void scene_set_tiles(scene_t *s, int enable, unsigned char palette);
+void scene_set_scroll(scene_t *s, unsigned short x, unsigned short y,
+                      int line_scroll);
+void scene_set_name(scene_t *s, unsigned int col, unsigned int row,
+                    unsigned char tile);
+void scene_set_pattern(scene_t *s, unsigned char tile,
+                       const unsigned char pattern[16]);
+void scene_set_line_scroll(scene_t *s, unsigned int line, unsigned short x);
+
+/* Send everything dirty; the bytes sent, or -1 */
+int scene_commit(scene_t *s);
+
+void scene_get_stats(scene_t *s, scene_stats_t *stats);
+
+#endif
@@ -31,19 +31,119 @@
 #include <linux/of_address.h>
 #include <linux/fs.h>
 #include <linux/uaccess.h>
+#include <linux/interrupt.h>
+#include <linux/dma-mapping.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
+#include <linux/kfifo.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/spinlock.h>
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include "vga_ball.h"
 
 #define DRIVER_NAME "vga_ball"
 
-/* Device registers */
-#define BG_RED(x) (x)
-#define BG_GREEN(x) ((x)+1)
-#define BG_BLUE(x) ((x)+2)
-#define BALL_X_L(x) ((x)+3)
-#define BALL_X_H(x) ((x)+4)
-#define BALL_Y_L(x) ((x)+5)
-#define BALL_Y_H(x) ((x)+6)
+/* Device registers: must match the register map in vga_ball.sv */
+#define BALL_COLOR(x) (x)
+#define BALL_X_H(x) ((x)+3)
+#define BALL_X_L(x) ((x)+4)
+#define BALL_Y_H(x) ((x)+5)
+#define BALL_Y_L(x) ((x)+6)
 #define BALL_RADIUS(x) ((x)+7)
+#define BG_COLOR(x) ((x)+8)
+#define TILE_CTRL(x) ((x)+11)
+#define TILE_PALETTE(x) ((x)+12)
+#define SCROLL_X_H(x) ((x)+21)
+#define SCROLL_X_L(x) ((x)+22)
+#define SCROLL_Y_H(x) ((x)+23)
+#define SCROLL_Y_L(x) ((x)+24)
+#define DMA_DESC(x) ((x)+0x20)
+#define CTRL(x) ((x)+0x24)
+#define STATUS(x) ((x)+0x25)
+#define PALETTE(x, i) ((x)+VGA_BALL_PALETTE_BASE+4*(i))
+#define NAME_TABLE(x) ((x)+VGA_BALL_NAME_BASE)
+#define PATTERNS(x) ((x)+VGA_BALL_PATTERN_BASE)
+#define LINE_SCROLL(x) ((x)+VGA_BALL_LINE_SCROLL_BASE)
+
+/* Bits of TILE_CTRL */
+#define TILE_CTRL_ENABLE 0x01
+#define TILE_CTRL_LINE_SCROLL 0x02
+
+/* Bits of CTRL and STATUS */
+#define CTRL_DMA_START 0x01
+#define CTRL_DMA_IRQ 0x02
+#define CTRL_VBLANK_IRQ 0x04
+#define STATUS_DMA_BUSY 0x01
+#define STATUS_DMA_DONE 0x02
+#define STATUS_VBLANK 0x04
+
+/*
+ * DMA buffer: block data, then one three-word descriptor per block.
+ * The FPGA-to-HPS bridge does not snoop the caches, so it is allocated
+ * coherent (uncached).
+ */
+#define DMA_DESC_OFFSET VGA_BALL_DMA_MAX
+#define DMA_BUF_SIZE (DMA_DESC_OFFSET + VGA_BALL_DMA_BLOCKS * 3 * sizeof(u32))
+#define DMA_TIMEOUT_MS 100
+
+/* Bytes copied from userspace per step of a block write */
+#define BLOCK_CHUNK 64
+
+/* Bytes copied from userspace per step of a write() */
+#define WRITE_CHUNK 256
+
+/*
+ * With an interrupt, write() queues its data and the vblank interrupt
+ * thread copies it to the registers, so updates land during blanking
+ * and a writer never waits on the bus.  Each queued record is a
+ * header and up to WRITE_CHUNK bytes.
+ */
+#define QUEUE_SIZE 16384 /* Power of two, for kfifo */
+
+struct queue_rec {
+	u16 offset;
+	u16 length;
+	u8 data[WRITE_CHUNK];
+};
+
+#define QUEUE_HDR offsetof(struct queue_rec, data)
+
+/*
+ * Frame timing: 525 lines of 1600 50 MHz clocks per frame, of which
+ * the 45 lines after line 480 are vertical blanking
+ */
+#define FRAME_NS (525 * 1600 * 20)
+#define VBLANK_NS (45 * 1600 * 20)
+
+/* Histogram sizes: updates per frame, and ioctl latency in log2 us */
+#define FRAME_BUCKETS 16
+#define LATENCY_BUCKETS 16
+
+/*
+ * Counters read through sysfs and debugfs.  The vblank interrupt ends
+ * a frame; an update is one ioctl that writes, one direct write(), or
+ * one drain of the write() queue.  An update is late if it lands after
+ * blanking has ended, which can only be told with the interrupt.
+ */
+struct vga_ball_stats {
+	spinlock_t lock;
+	u64 frames;
+	u64 missed_vblanks;
+	u64 updates;
+	u64 late_updates;
+	unsigned int frame_updates;      /* Updates so far this frame */
+	unsigned int last_frame_updates;
+	unsigned int max_frame_updates;
+	u64 frame_hist[FRAME_BUCKETS];   /* Frames by updates in them */
+	u64 latency[LATENCY_BUCKETS];    /* Bucket n: under 2^n us */
+	ktime_t last_vblank;
+	atomic64_t mmio_writes;          /* Bytes written to the registers */
+};
 
 /*
  * Information about our device
@@ -51,37 +151,470 @@
 struct vga_ball_dev {
 	struct resource res; /* Resource: our registers */
 	void __iomem *virtbase; /* Where registers can be accessed in memory */
-    vga_ball_color_t background;
+    vga_ball_color_t palette[VGA_BALL_PALETTE_SIZE];
+    vga_ball_color_index_t colors;
     vga_ball_position_t position;
+    vga_ball_tiles_t tiles;
+    vga_ball_scroll_t scroll;
+	int irq;                /* DMA done and vblank interrupt, 0 if none */
+	u8 ctrl;                /* Interrupt enables in CTRL */
+	void *dma_buf;          /* Descriptors and data for DMA uploads */
+	dma_addr_t dma_bus;
+	struct completion dma_done;
+	struct mutex dma_lock;  /* One upload at a time */
+	bool dma_stuck;         /* Timed out busy: no DMA until FPGA reset */
+	DECLARE_KFIFO(queue, u8, QUEUE_SIZE); /* Records from write() */
+	struct mutex queue_lock; /* Serializes writers */
+	wait_queue_head_t queue_wait; /* Woken when the queue drains */
+	unsigned int vblank_seq; /* Vertical blanks seen by the interrupt */
+	wait_queue_head_t vblank_wait;
+	struct vga_ball_stats stats;
+	struct dentry *debugfs;
 } dev;
 
+/* Register writes, counted for the statistics */
+static inline void reg_write8(u8 value, void __iomem *addr) {
+	atomic64_inc(&dev.stats.mmio_writes);
+	iowrite8(value, addr);
+}
+
+static inline void reg_copy(void __iomem *addr, const void *data, size_t n) {
+	atomic64_add(n, &dev.stats.mmio_writes);
+	memcpy_toio(addr, data, n);
+}
+
+/* Count an update in the current frame */
+static void stats_update(void) {
+	struct vga_ball_stats *st = &dev.stats;
+	ktime_t now = ktime_get();
+	unsigned long flags;
+
+	spin_lock_irqsave(&st->lock, flags);
+	st->updates++;
+	st->frame_updates++;
+	if (dev.irq && st->frames &&
+	    ktime_to_ns(ktime_sub(now, st->last_vblank)) > VBLANK_NS)
+		st->late_updates++;
+	spin_unlock_irqrestore(&st->lock, flags);
+}
+
+/* Close a frame at the vblank interrupt; a long gap means missed ones */
+static void stats_vblank(void) {
+	struct vga_ball_stats *st = &dev.stats;
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	u64 gap;
+
+	spin_lock_irqsave(&st->lock, flags);
+	if (st->frames) {
+		gap = ktime_to_ns(ktime_sub(now, st->last_vblank));
+		gap = div_u64(gap + FRAME_NS / 2, FRAME_NS);
+		if (gap > 1)
+			st->missed_vblanks += gap - 1;
+	}
+	st->frames++;
+	st->last_vblank = now;
+	st->frame_hist[min_t(unsigned int, st->frame_updates,
+			     FRAME_BUCKETS - 1)]++;
+	st->last_frame_updates = st->frame_updates;
+	if (st->frame_updates > st->max_frame_updates)
+		st->max_frame_updates = st->frame_updates;
+	st->frame_updates = 0;
+	spin_unlock_irqrestore(&st->lock, flags);
+}
+
+static void stats_latency(ktime_t start) {
+	struct vga_ball_stats *st = &dev.stats;
+	s64 us = ktime_us_delta(ktime_get(), start);
+	unsigned int bucket = us > 0 ? ilog2(us) + 1 : 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(&st->lock, flags);
+	st->latency[min_t(unsigned int, bucket, LATENCY_BUCKETS - 1)]++;
+	spin_unlock_irqrestore(&st->lock, flags);
+}
+
 /*
- * Write segments of a single digit
- * Assumes digit is in range and the device information has been set up
+ * Write palette entry i and keep its shadow in dev.palette
+ * Assumes i is in range and the device information has been set up
  */
+static void write_palette_entry(unsigned int i, const vga_ball_color_t *c) {
+	reg_write8(c->red, PALETTE(dev.virtbase, i));
+	reg_write8(c->green, PALETTE(dev.virtbase, i) + 1);
+	reg_write8(c->blue, PALETTE(dev.virtbase, i) + 2);
+	dev.palette[i] = *c;
+}
+
+/* The background color is the palette entry the background names */
 static void write_background(vga_ball_color_t *background) {
-	iowrite8(background->red, BG_RED(dev.virtbase));
-	iowrite8(background->green, BG_GREEN(dev.virtbase));
-	iowrite8(background->blue, BG_BLUE(dev.virtbase));
-	dev.background = *background;
+	write_palette_entry(dev.colors.background, background);
+}
+
+static void write_color_index(vga_ball_color_index_t *colors) {
+	reg_write8(colors->circle, BALL_COLOR(dev.virtbase));
+	reg_write8(colors->background, BG_COLOR(dev.virtbase));
+	dev.colors = *colors;
+}
+
+/*
+ * Copy a range of palette entries from userspace
+ */
+static int load_palette(vga_ball_palette_t *palette) {
+	vga_ball_color_t buf[BLOCK_CHUNK];
+	unsigned int done, n, i;
+
+	if (palette->first + palette->count > VGA_BALL_PALETTE_SIZE)
+		return -EINVAL;
+
+	for (done = 0; done < palette->count; done += n) {
+		n = min_t(unsigned int, palette->count - done, BLOCK_CHUNK);
+		if (copy_from_user(buf, palette->colors + done,
+				   n * sizeof(vga_ball_color_t)))
+			return -EACCES;
+		for (i = 0; i < n; i++)
+			write_palette_entry(palette->first + done + i, &buf[i]);
+	}
+	return 0;
+}
+
+/*
+ * Write the circle center, x and y in 12.4 fixed point
+ */
+static void write_position_fixed(unsigned short x, unsigned short y) {
+	reg_write8((unsigned char)(x >> 8), BALL_X_H(dev.virtbase));
+	reg_write8((unsigned char)(x & 0xFF), BALL_X_L(dev.virtbase));
+	reg_write8((unsigned char)(y >> 8), BALL_Y_H(dev.virtbase));
+	reg_write8((unsigned char)(y & 0xFF), BALL_Y_L(dev.virtbase));
+	dev.position.x = x >> VGA_BALL_FRAC_BITS;
+	dev.position.x_frac = x & ((1 << VGA_BALL_FRAC_BITS) - 1);
+	dev.position.y = y >> VGA_BALL_FRAC_BITS;
+	dev.position.y_frac = y & ((1 << VGA_BALL_FRAC_BITS) - 1);
 }
 
 static void write_position(vga_ball_position_t *position) {
-	iowrite8((unsigned char)(position->x & 0xFF), BALL_X_L(dev.virtbase));
-	iowrite8((unsigned char)((position->x >> 8) & 0x07), BALL_X_H(dev.virtbase));
-	iowrite8((unsigned char)(position->y & 0xFF), BALL_Y_L(dev.virtbase));
-	iowrite8((unsigned char)((position->y >> 8) & 0x03), BALL_Y_H(dev.virtbase));
-	dev.position = *position;
+	unsigned short x = (position->x << VGA_BALL_FRAC_BITS) |
+		(position->x_frac & ((1 << VGA_BALL_FRAC_BITS) - 1));
+	unsigned short y = (position->y << VGA_BALL_FRAC_BITS) |
+		(position->y_frac & ((1 << VGA_BALL_FRAC_BITS) - 1));
+
+	write_position_fixed(x, y);
 	printk(KERN_INFO "%d, %d \n", position->x, position->y);
 }
 
+/* TILE_CTRL holds bits from both the tile and scroll settings */
+static void write_tile_ctrl(void) {
+	reg_write8((dev.tiles.enable ? TILE_CTRL_ENABLE : 0) |
+		 (dev.scroll.line_scroll ? TILE_CTRL_LINE_SCROLL : 0),
+		 TILE_CTRL(dev.virtbase));
+}
+
+static void write_tiles(vga_ball_tiles_t *tiles) {
+	reg_write8(tiles->palette & 0x3F, TILE_PALETTE(dev.virtbase));
+	dev.tiles = *tiles;
+	write_tile_ctrl();
+}
+
+static void write_scroll(vga_ball_scroll_t *scroll) {
+	reg_write8((unsigned char)((scroll->x >> 8) & 0x03), SCROLL_X_H(dev.virtbase));
+	reg_write8((unsigned char)(scroll->x & 0xFF), SCROLL_X_L(dev.virtbase));
+	reg_write8((unsigned char)((scroll->y >> 8) & 0x01), SCROLL_Y_H(dev.virtbase));
+	reg_write8((unsigned char)(scroll->y & 0xFF), SCROLL_Y_L(dev.virtbase));
+	dev.scroll = *scroll;
+	write_tile_ctrl();
+}
+
+/*
+ * Copy a run of bytes from userspace into one of the tile memories
+ * that starts at base and holds size bytes
+ */
+static int write_block(void __iomem *base, unsigned int size,
+		       vga_ball_block_t *block) {
+	unsigned char buf[BLOCK_CHUNK];
+	unsigned int done, n, i;
+
+	if (block->offset + block->length > size)
+		return -EINVAL;
+
+	for (done = 0; done < block->length; done += n) {
+		n = min_t(unsigned int, block->length - done, BLOCK_CHUNK);
+		if (copy_from_user(buf, block->data + done, n))
+			return -EACCES;
+		for (i = 0; i < n; i++)
+			reg_write8(buf[i], base + block->offset + done + i);
+	}
+	return 0;
+}
+
+/*
+ * Keep the palette shadow in step with a block that a DMA upload
+ * writes into the palette memory
+ */
+static void shadow_palette(unsigned int offset, const u8 *data,
+			   unsigned int length) {
+	unsigned int i, a, entry;
+
+	for (i = 0; i < length; i++) {
+		a = offset + i;
+		if (a < VGA_BALL_PALETTE_BASE || a >= VGA_BALL_NAME_BASE)
+			continue;
+		entry = (a - VGA_BALL_PALETTE_BASE) / 4;
+		switch ((a - VGA_BALL_PALETTE_BASE) % 4) {
+		case 0:
+			dev.palette[entry].red = data[i];
+			break;
+		case 1:
+			dev.palette[entry].green = data[i];
+			break;
+		case 2:
+			dev.palette[entry].blue = data[i];
+			break;
+		}
+	}
+}
+
+/*
+ * After a timeout: if the engine is idle, its chain ended or never
+ * started, so clear DONE and let any interrupt in flight finish before
+ * the completion is reused.  An engine still busy may yet read the
+ * buffer, and it has no abort, so DMA stays off (and the buffer is
+ * never reused or freed) until the FPGA is reset.
+ */
+static void dma_recover(void) {
+	if (ioread8(STATUS(dev.virtbase)) & STATUS_DMA_BUSY) {
+		dev.dma_stuck = true;
+		pr_err(DRIVER_NAME ": DMA engine stuck; uploads disabled\n");
+		return;
+	}
+	reg_write8(STATUS_DMA_DONE, STATUS(dev.virtbase));
+	synchronize_irq(dev.irq);
+}
+
+/*
+ * Copy userspace blocks into the DMA buffer, chain one descriptor per
+ * block, start the engine and sleep until its completion interrupt.
+ * The palette shadow follows only once the blocks have landed.
+ */
+static int dma_upload(vga_ball_dma_t *dma) {
+	vga_ball_block_t blocks[VGA_BALL_DMA_BLOCKS];
+	u32 *desc = dev.dma_buf + DMA_DESC_OFFSET;
+	dma_addr_t desc_bus = dev.dma_bus + DMA_DESC_OFFSET;
+	unsigned int i, data = 0;
+	u8 *p;
+	int ret = 0;
+
+	if (!dev.dma_buf)
+		return -ENODEV;
+	if (dma->count == 0 || dma->count > VGA_BALL_DMA_BLOCKS)
+		return -EINVAL;
+	if (copy_from_user(blocks, dma->blocks,
+			   dma->count * sizeof(vga_ball_block_t)))
+		return -EACCES;
+
+	mutex_lock(&dev.dma_lock);
+
+	if (dev.dma_stuck) {
+		ret = -EIO;
+		goto out;
+	}
+
+	for (i = 0; i < dma->count; i++) {
+		if (blocks[i].offset < VGA_BALL_PALETTE_BASE ||
+		    blocks[i].offset + blocks[i].length > VGA_BALL_MEM_END ||
+		    data + blocks[i].length > VGA_BALL_DMA_MAX) {
+			ret = -EINVAL;
+			goto out;
+		}
+		p = dev.dma_buf + data;
+		if (copy_from_user(p, blocks[i].data, blocks[i].length)) {
+			ret = -EACCES;
+			goto out;
+		}
+
+		desc[3*i] = cpu_to_le32(dev.dma_bus + data);
+		desc[3*i+1] = cpu_to_le32(blocks[i].offset |
+					  (blocks[i].length << 16));
+		desc[3*i+2] = cpu_to_le32(i + 1 < dma->count ?
+					  desc_bus + 12 * (i + 1) : 0);
+
+		data = ALIGN(data + blocks[i].length, 4);
+	}
+
+	reinit_completion(&dev.dma_done);
+	reg_write8((desc_bus >> 24) & 0xFF, DMA_DESC(dev.virtbase));
+	reg_write8((desc_bus >> 16) & 0xFF, DMA_DESC(dev.virtbase) + 1);
+	reg_write8((desc_bus >> 8) & 0xFF, DMA_DESC(dev.virtbase) + 2);
+	reg_write8(desc_bus & 0xFF, DMA_DESC(dev.virtbase) + 3);
+	reg_write8(dev.ctrl | CTRL_DMA_START, CTRL(dev.virtbase));
+
+	if (!wait_for_completion_timeout(&dev.dma_done,
+					 msecs_to_jiffies(DMA_TIMEOUT_MS))) {
+		dma_recover();
+		ret = -ETIMEDOUT;
+		goto out;
+	}
+
+	for (i = 0, data = 0; i < dma->count; i++) {
+		shadow_palette(blocks[i].offset, dev.dma_buf + data,
+			       blocks[i].length);
+		data = ALIGN(data + blocks[i].length, 4);
+	}
+out:
+	mutex_unlock(&dev.dma_lock);
+	return ret;
+}
+
+/*
+ * DMA completion wakes the uploader; the start of vertical blanking
+ * wakes the thread that drains the write() queue
+ */
+static irqreturn_t vga_ball_irq(int irq, void *dev_id) {
+	u8 status = ioread8(STATUS(dev.virtbase));
+	irqreturn_t ret = IRQ_NONE;
+
+	if (status & STATUS_DMA_DONE) {
+		reg_write8(STATUS_DMA_DONE, STATUS(dev.virtbase));
+		complete(&dev.dma_done);
+		ret = IRQ_HANDLED;
+	}
+	if (status & STATUS_VBLANK) {
+		reg_write8(STATUS_VBLANK, STATUS(dev.virtbase));
+		stats_vblank();
+		WRITE_ONCE(dev.vblank_seq, dev.vblank_seq + 1);
+		wake_up_interruptible(&dev.vblank_wait);
+		ret = IRQ_WAKE_THREAD;
+	}
+	return ret;
+}
+
+static irqreturn_t vga_ball_irq_thread(int irq, void *dev_id) {
+	struct queue_rec rec;
+	bool drained = false;
+
+	while (kfifo_out(&dev.queue, (u8 *)&rec, QUEUE_HDR) == QUEUE_HDR) {
+		if (kfifo_out(&dev.queue, rec.data, rec.length) != rec.length)
+			break;
+		reg_copy(dev.virtbase + rec.offset, rec.data, rec.length);
+		shadow_palette(rec.offset, rec.data, rec.length);
+		drained = true;
+	}
+	if (drained)
+		stats_update();
+	wake_up_interruptible(&dev.queue_wait);
+	return IRQ_HANDLED;
+}
+
+/*
+ * Add a record to the write() queue, waiting for room unless nonblock
+ */
+static int queue_record(struct queue_rec *rec, bool nonblock) {
+	unsigned int len = QUEUE_HDR + rec->length;
+
+	for (;;) {
+		mutex_lock(&dev.queue_lock);
+		if (kfifo_avail(&dev.queue) >= len) {
+			kfifo_in(&dev.queue, (u8 *)rec, len);
+			mutex_unlock(&dev.queue_lock);
+			return 0;
+		}
+		mutex_unlock(&dev.queue_lock);
+
+		if (nonblock)
+			return -EAGAIN;
+		if (wait_event_interruptible(dev.queue_wait,
+					     kfifo_avail(&dev.queue) >= len))
+			return -ERESTARTSYS;
+	}
+}
+
+/*
+ * Copy count bytes from userspace to register offset pos, directly or
+ * through the queue.  Returns the bytes written if any, else an error.
+ * Ranges that touch the DMA and interrupt registers are refused: a
+ * client could otherwise stop the vblank interrupt or aim the DMA
+ * engine at memory of its choosing.
+ */
+static ssize_t write_range(size_t pos, const char __user *buf, size_t count,
+			   bool nonblock) {
+	struct queue_rec rec;
+	size_t done, n;
+	int ret;
+
+	if (VGA_BALL_HITS_CTRL(pos, count))
+		return -EINVAL;
+
+	for (done = 0; done < count; done += n) {
+		n = min_t(size_t, count - done, WRITE_CHUNK);
+		if (copy_from_user(rec.data, buf + done, n)) {
+			if (done)
+				break;
+			return -EACCES;
+		}
+
+		if (!dev.irq) {
+			reg_copy(dev.virtbase + pos + done, rec.data, n);
+			shadow_palette(pos + done, rec.data, n);
+			continue;
+		}
+
+		rec.offset = pos + done;
+		rec.length = n;
+		ret = queue_record(&rec, nonblock);
+		if (ret) {
+			if (done)
+				break;
+			return ret;
+		}
+	}
+	return done;
+}
+
+/*
+ * Write a list of blocks anywhere in the register window but the DMA
+ * and interrupt registers, as write() would.  Every block is checked
+ * before any is written, so a bad one leaves none applied.
+ */
+static int write_blocks(vga_ball_dma_t *list, bool nonblock) {
+	vga_ball_block_t blocks[VGA_BALL_DMA_BLOCKS];
+	size_t size = resource_size(&dev.res);
+	unsigned int i;
+	ssize_t ret;
+
+	if (list->count > VGA_BALL_DMA_BLOCKS)
+		return -EINVAL;
+	if (copy_from_user(blocks, list->blocks,
+			   list->count * sizeof(vga_ball_block_t)))
+		return -EACCES;
+	for (i = 0; i < list->count; i++)
+		if (blocks[i].offset + blocks[i].length > size ||
+		    VGA_BALL_HITS_CTRL(blocks[i].offset, blocks[i].length))
+			return -EINVAL;
+
+	for (i = 0; i < list->count; i++) {
+		ret = write_range(blocks[i].offset,
+				  (const char __user *)blocks[i].data,
+				  blocks[i].length, nonblock);
+		if (ret < 0)
+			return ret;
+		if (ret < blocks[i].length)
+			return -EAGAIN;
+	}
+	return 0;
+}
+
 /*
  * Handle ioctl() calls from userspace:
  * Read or write the segments on single digits.
  * Note extensive error checking of arguments
  */
-static long vga_ball_ioctl(struct file *f, unsigned int cmd, unsigned long arg) {
+static long do_ioctl(struct file *f, unsigned int cmd, unsigned long arg) {
 	vga_ball_arg_t vla;
+	vga_ball_tiles_t tiles;
+	vga_ball_scroll_t scroll;
+	vga_ball_block_t block;
+	vga_ball_palette_t palette;
+	vga_ball_color_index_t colors;
+	vga_ball_dma_t dma;
+	vga_ball_color_t color;
 
 	switch (cmd) {
 	case VGA_BALL_WRITE_BACKGROUND:
@@ -92,7 +625,7 @@ static long vga_ball_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 		break;
 
 	case VGA_BALL_READ_BACKGROUND:
-	  	vla.background = dev.background;
+	  	vla.background = dev.palette[dev.colors.background];
 		if (copy_to_user((vga_ball_arg_t *) arg, &vla,
 				 sizeof(vga_ball_arg_t)))
 			return -EACCES;
@@ -112,6 +645,78 @@ static long vga_ball_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 			return -EACCES;
 		break;
 
+	case VGA_BALL_WRITE_TILES:
+		if (copy_from_user(&tiles, (vga_ball_tiles_t *) arg,
+				   sizeof(vga_ball_tiles_t)))
+			return -EACCES;
+		write_tiles(&tiles);
+		break;
+
+	case VGA_BALL_WRITE_NAMES:
+		if (copy_from_user(&block, (vga_ball_block_t *) arg,
+				   sizeof(vga_ball_block_t)))
+			return -EACCES;
+		return write_block(NAME_TABLE(dev.virtbase),
+				   VGA_BALL_NAME_SIZE, &block);
+
+	case VGA_BALL_WRITE_PATTERNS:
+		if (copy_from_user(&block, (vga_ball_block_t *) arg,
+				   sizeof(vga_ball_block_t)))
+			return -EACCES;
+		return write_block(PATTERNS(dev.virtbase),
+				   VGA_BALL_PATTERN_SIZE, &block);
+
+	case VGA_BALL_WRITE_SCROLL:
+		if (copy_from_user(&scroll, (vga_ball_scroll_t *) arg,
+				   sizeof(vga_ball_scroll_t)))
+			return -EACCES;
+		write_scroll(&scroll);
+		break;
+
+	case VGA_BALL_WRITE_LINE_SCROLL:
+		if (copy_from_user(&block, (vga_ball_block_t *) arg,
+				   sizeof(vga_ball_block_t)))
+			return -EACCES;
+		return write_block(LINE_SCROLL(dev.virtbase),
+				   VGA_BALL_LINE_SCROLL_SIZE, &block);
+
+	case VGA_BALL_LOAD_PALETTE:
+		if (copy_from_user(&palette, (vga_ball_palette_t *) arg,
+				   sizeof(vga_ball_palette_t)))
+			return -EACCES;
+		return load_palette(&palette);
+
+	case VGA_BALL_WRITE_COLOR_INDEX:
+		if (copy_from_user(&colors, (vga_ball_color_index_t *) arg,
+				   sizeof(vga_ball_color_index_t)))
+			return -EACCES;
+		write_color_index(&colors);
+		break;
+
+	case VGA_BALL_DMA_UPLOAD:
+		if (copy_from_user(&dma, (vga_ball_dma_t *) arg,
+				   sizeof(vga_ball_dma_t)))
+			return -EACCES;
+		return dma_upload(&dma);
+
+	case VGA_BALL_WRITE_BLOCKS:
+		if (copy_from_user(&dma, (vga_ball_dma_t *) arg,
+				   sizeof(vga_ball_dma_t)))
+			return -EACCES;
+		return write_blocks(&dma, f->f_flags & O_NONBLOCK);
+
+	/* Compact ABI: the value is in arg, so there is nothing to copy */
+	case VGA_BALL_SET_POSITION:
+		write_position_fixed(arg >> 16, arg & 0xFFFF);
+		break;
+
+	case VGA_BALL_SET_BACKGROUND:
+		color.red = (arg >> 24) & 0xFF;
+		color.green = (arg >> 16) & 0xFF;
+		color.blue = (arg >> 8) & 0xFF;
+		write_background(&color);
+		break;
+
 	default:
 		return -EINVAL;
 	}
@@ -119,10 +724,217 @@ static long vga_ball_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 	return 0;
 }
 
+/*
+ * Time every ioctl; count all but the reads as updates, except that
+ * queued blocks count when the queue drains
+ */
+static long vga_ball_ioctl(struct file *f, unsigned int cmd, unsigned long arg) {
+	ktime_t start = ktime_get();
+	long ret = do_ioctl(f, cmd, arg);
+
+	if (ret == 0 && !(_IOC_DIR(cmd) & _IOC_READ) &&
+	    !(cmd == VGA_BALL_WRITE_BLOCKS && dev.irq))
+		stats_update();
+	stats_latency(start);
+	return ret;
+}
+
+/*
+ * Handle write() and pwrite() calls from userspace: the file position is
+ * a byte offset in the register window, so a scene's palette and tile
+ * memories can be written with one call.  A range that includes the DMA
+ * and interrupt registers is refused with -EINVAL.  Only the palette
+ * shadow is kept up to date; the READ ioctls do not see other registers
+ * written this way.
+ *
+ * With an interrupt the data is queued for the next vertical blank;
+ * with O_NONBLOCK a full queue returns -EAGAIN (or a short count) and
+ * poll() reports POLLOUT once a full chunk fits again.
+ */
+static ssize_t vga_ball_write(struct file *f, const char __user *buf,
+			      size_t count, loff_t *ppos) {
+	loff_t pos = *ppos;
+	size_t size = resource_size(&dev.res);
+	ssize_t done;
+
+	if (pos < 0 || pos >= size)
+		return count ? -ENOSPC : 0;
+	count = min_t(size_t, count, size - pos);
+
+	done = write_range(pos, buf, count, f->f_flags & O_NONBLOCK);
+	if (done <= 0)
+		return done;
+	if (!dev.irq)
+		stats_update();
+	*ppos = pos + done;
+	return done;
+}
+
+/*
+ * Each open file remembers the last vertical blank it has read, so
+ * several clients can each wait for the next one
+ */
+static int vga_ball_open(struct inode *inode, struct file *f) {
+	f->private_data = (void *)(unsigned long)READ_ONCE(dev.vblank_seq);
+	return 0;
+}
+
+/*
+ * Handle read() calls from userspace: wait for a vertical blank this
+ * file has not seen and return the vblank count as a 32-bit value.
+ * The file position is ignored.  With O_NONBLOCK, -EAGAIN if there is
+ * no new vertical blank yet.
+ */
+static ssize_t vga_ball_read(struct file *f, char __user *buf,
+			     size_t count, loff_t *ppos) {
+	unsigned int seen = (unsigned long)f->private_data;
+	unsigned int seq;
+
+	if (!dev.irq)
+		return -ENODEV;
+	if (count < sizeof(seq))
+		return -EINVAL;
+
+	if (READ_ONCE(dev.vblank_seq) == seen) {
+		if (f->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (wait_event_interruptible(dev.vblank_wait,
+					     READ_ONCE(dev.vblank_seq) != seen))
+			return -ERESTARTSYS;
+	}
+
+	seq = READ_ONCE(dev.vblank_seq);
+	f->private_data = (void *)(unsigned long)seq;
+	if (copy_to_user(buf, &seq, sizeof(seq)))
+		return -EACCES;
+	return sizeof(seq);
+}
+
+/* POLLIN: a new vertical blank to read; POLLOUT: room in the queue */
+static __poll_t vga_ball_poll(struct file *f, poll_table *wait) {
+	unsigned int seen = (unsigned long)f->private_data;
+	__poll_t mask = 0;
+
+	poll_wait(f, &dev.queue_wait, wait);
+	poll_wait(f, &dev.vblank_wait, wait);
+	if (!dev.irq || kfifo_avail(&dev.queue) >= sizeof(struct queue_rec))
+		mask |= EPOLLOUT | EPOLLWRNORM;
+	if (dev.irq && READ_ONCE(dev.vblank_seq) != seen)
+		mask |= EPOLLIN | EPOLLRDNORM;
+	return mask;
+}
+
+static loff_t vga_ball_llseek(struct file *f, loff_t offset, int whence) {
+	return fixed_size_llseek(f, offset, whence, resource_size(&dev.res));
+}
+
+/*
+ * Counters in /sys/class/misc/vga_ball/, read under the stats lock:
+ * a u64 takes two loads on 32-bit ARM and could tear
+ */
+#define STATS_ATTR(name, fmt)						\
+static ssize_t name##_show(struct device *d,				\
+			   struct device_attribute *attr, char *buf) {	\
+	typeof(dev.stats.name) val;					\
+	unsigned long flags;						\
+									\
+	spin_lock_irqsave(&dev.stats.lock, flags);			\
+	val = dev.stats.name;						\
+	spin_unlock_irqrestore(&dev.stats.lock, flags);			\
+	return sprintf(buf, fmt "\n", val);				\
+}									\
+static DEVICE_ATTR_RO(name)
+
+STATS_ATTR(frames, "%llu");
+STATS_ATTR(missed_vblanks, "%llu");
+STATS_ATTR(updates, "%llu");
+STATS_ATTR(late_updates, "%llu");
+STATS_ATTR(last_frame_updates, "%u");
+STATS_ATTR(max_frame_updates, "%u");
+
+static ssize_t mmio_writes_show(struct device *d,
+				struct device_attribute *attr, char *buf) {
+	return sprintf(buf, "%lld\n",
+		       (long long)atomic64_read(&dev.stats.mmio_writes));
+}
+static DEVICE_ATTR_RO(mmio_writes);
+
+static struct attribute *vga_ball_attrs[] = {
+	&dev_attr_frames.attr,
+	&dev_attr_missed_vblanks.attr,
+	&dev_attr_updates.attr,
+	&dev_attr_late_updates.attr,
+	&dev_attr_last_frame_updates.attr,
+	&dev_attr_max_frame_updates.attr,
+	&dev_attr_mmio_writes.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(vga_ball);
+
+/*
+ * debugfs vga_ball/histograms: updates per frame and ioctl latency.
+ * Writing anything to the file clears both histograms and the maximum.
+ */
+static int histograms_show(struct seq_file *m, void *v) {
+	struct vga_ball_stats *st = &dev.stats;
+	u64 frame_hist[FRAME_BUCKETS], latency[LATENCY_BUCKETS];
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&st->lock, flags);
+	memcpy(frame_hist, st->frame_hist, sizeof(frame_hist));
+	memcpy(latency, st->latency, sizeof(latency));
+	spin_unlock_irqrestore(&st->lock, flags);
+
+	seq_puts(m, "updates/frame   frames\n");
+	for (i = 0; i < FRAME_BUCKETS; i++)
+		seq_printf(m, "%12u%s %8llu\n", i,
+			   i == FRAME_BUCKETS - 1 ? "+" : " ", frame_hist[i]);
+
+	seq_puts(m, "\nioctl latency    calls\n");
+	for (i = 0; i < LATENCY_BUCKETS; i++)
+		seq_printf(m, "%s%8lu us %8llu\n",
+			   i == LATENCY_BUCKETS - 1 ? ">=" : " <",
+			   i == LATENCY_BUCKETS - 1 ? 1UL << (i - 1) : 1UL << i,
+			   latency[i]);
+	return 0;
+}
+
+static int histograms_open(struct inode *inode, struct file *f) {
+	return single_open(f, histograms_show, NULL);
+}
+
+static ssize_t histograms_write(struct file *f, const char __user *buf,
+				size_t count, loff_t *ppos) {
+	struct vga_ball_stats *st = &dev.stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&st->lock, flags);
+	memset(st->frame_hist, 0, sizeof(st->frame_hist));
+	memset(st->latency, 0, sizeof(st->latency));
+	st->max_frame_updates = 0;
+	spin_unlock_irqrestore(&st->lock, flags);
+	return count;
+}
+
+static const struct file_operations histograms_fops = {
+	.owner		= THIS_MODULE,
+	.open		= histograms_open,
+	.read		= seq_read,
+	.write		= histograms_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /* The operations our device knows how to do */
 static const struct file_operations vga_ball_fops = {
 	.owner		= THIS_MODULE,
 	.unlocked_ioctl = vga_ball_ioctl,
+	.open		= vga_ball_open,
+	.read		= vga_ball_read,
+	.write		= vga_ball_write,
+	.poll		= vga_ball_poll,
+	.llseek		= vga_ball_llseek,
 };
 
 /* Information about our device for the "misc" framework -- like a char dev */
@@ -130,6 +942,7 @@ static struct miscdevice vga_ball_misc_device = {
 	.minor		= MISC_DYNAMIC_MINOR,
 	.name		= DRIVER_NAME,
 	.fops		= &vga_ball_fops,
+	.groups		= vga_ball_groups,
 };
 
 /*
@@ -137,10 +950,14 @@ static struct miscdevice vga_ball_misc_device = {
  * a welcome message
  */
 static int __init vga_ball_probe(struct platform_device *pdev) {
-	vga_ball_position_t init_pos = {256, 128};
+	vga_ball_position_t init_pos = {256, 128, 0, 0};
     vga_ball_color_t beige = {0xf9, 0xe4, 0xb7};
+    vga_ball_color_index_t init_colors = {1, 0};
 	int ret;
 
+	spin_lock_init(&dev.stats.lock);
+	atomic64_set(&dev.stats.mmio_writes, 0);
+
 	/* Register ourselves as a misc device: creates /dev/vga_ball */
 	ret = misc_register(&vga_ball_misc_device);
 
@@ -164,13 +981,58 @@ static int __init vga_ball_probe(struct platform_device *pdev) {
 		ret = -ENOMEM;
 		goto out_release_mem_region;
 	}
+
+	/*
+	 * DMA uploads need the completion interrupt; hardware without
+	 * one still works through the register ioctls
+	 */
+	init_completion(&dev.dma_done);
+	mutex_init(&dev.dma_lock);
+	INIT_KFIFO(dev.queue);
+	mutex_init(&dev.queue_lock);
+	init_waitqueue_head(&dev.queue_wait);
+	init_waitqueue_head(&dev.vblank_wait);
+	dev.irq = platform_get_irq(pdev, 0);
+	if (dev.irq > 0) {
+		ret = dma_set_coherent_mask(&pdev->dev, DMA_BIT_MASK(32));
+		if (ret)
+			goto out_unmap;
+		dev.dma_buf = dma_alloc_coherent(&pdev->dev, DMA_BUF_SIZE,
+						 &dev.dma_bus, GFP_KERNEL);
+		if (dev.dma_buf == NULL) {
+			ret = -ENOMEM;
+			goto out_unmap;
+		}
+		ret = request_threaded_irq(dev.irq, vga_ball_irq,
+					   vga_ball_irq_thread, 0, DRIVER_NAME,
+					   &dev);
+		if (ret)
+			goto out_free_dma;
+		dev.ctrl = CTRL_DMA_IRQ | CTRL_VBLANK_IRQ;
+		reg_write8(dev.ctrl, CTRL(dev.virtbase));
+		/* Left stuck by an earlier load: wait for an FPGA reset */
+		if (ioread8(STATUS(dev.virtbase)) & STATUS_DMA_BUSY)
+			dev.dma_stuck = true;
+	} else {
+		dev.irq = 0;
+	}
         
 	/* Set an initial color and position */
+    write_color_index(&init_colors);
     write_background(&beige);
     write_position(&init_pos);
 
+	dev.debugfs = debugfs_create_dir(DRIVER_NAME, NULL);
+	debugfs_create_file("histograms", 0600, dev.debugfs, NULL,
+			    &histograms_fops);
+
 	return 0;
 
+out_free_dma:
+	dma_free_coherent(&pdev->dev, DMA_BUF_SIZE, dev.dma_buf, dev.dma_bus);
+	dev.dma_buf = NULL;
+out_unmap:
+	iounmap(dev.virtbase);
 out_release_mem_region:
 	release_mem_region(dev.res.start, resource_size(&dev.res));
 out_deregister:
@@ -181,6 +1043,15 @@ out_deregister:
 /* Clean-up code: release resources */
 static int vga_ball_remove(struct platform_device *pdev)
 {
+	debugfs_remove_recursive(dev.debugfs);
+	if (dev.irq) {
+		reg_write8(0, CTRL(dev.virtbase));
+		free_irq(dev.irq, &dev);
+		/* A stuck engine may still read the buffer: leave it be */
+		if (!dev.dma_stuck)
+			dma_free_coherent(&pdev->dev, DMA_BUF_SIZE, dev.dma_buf,
+					  dev.dma_bus);
+	}
 	iounmap(dev.virtbase);
 	release_mem_region(dev.res.start, resource_size(&dev.res));
 	misc_deregister(&vga_ball_misc_device);
@@ -7,16 +7,143 @@ typedef struct {
   unsigned char red, green, blue;
 } vga_ball_color_t;
 
+/*
+ * Circle center.  x and y are whole pixels; x_frac and y_frac add
+ * 1/16-pixel offsets so slow motion need not step a pixel at a time.
+ */
 typedef struct {
   unsigned short x;
   unsigned short y;
+  unsigned char x_frac, y_frac;
 } vga_ball_position_t;
 
+#define VGA_BALL_FRAC_BITS 4
+
 typedef struct {
   vga_ball_color_t background;
   vga_ball_position_t position;
 } vga_ball_arg_t;
 
+/*
+ * All colors on screen come from a 256-entry palette.  The circle and
+ * the background each name a palette entry.
+ */
+#define VGA_BALL_PALETTE_SIZE 256
+
+typedef struct {
+  unsigned char circle, background;
+} vga_ball_color_index_t;
+
+/* Load palette entries first .. first + count - 1 from colors */
+typedef struct {
+  unsigned short first, count;
+  const vga_ball_color_t *colors;
+} vga_ball_palette_t;
+
+/*
+ * Tile layer: a 64x32 name table of tile numbers and 256 8x8 patterns
+ * at 2 bits per pixel.  Each tile covers 16x16 screen pixels.  Pattern
+ * pixel 0 shows the background color; pixel p (1-3) uses palette entry
+ * palette * 4 + p.
+ */
+typedef struct {
+  unsigned char enable;
+  unsigned char palette;  /* 0-63 */
+} vga_ball_tiles_t;
+
+#define VGA_BALL_NAME_COLS     64
+#define VGA_BALL_NAME_ROWS     32
+#define VGA_BALL_NAME_SIZE     (VGA_BALL_NAME_COLS * VGA_BALL_NAME_ROWS)
+#define VGA_BALL_PATTERN_SIZE  4096  /* 256 tiles, 16 bytes each */
+
+/*
+ * Tile layer scroll offset in pixels; the 1024x512 map wraps.  Takes
+ * effect at the next vertical blank.  With line_scroll set, each
+ * scanline also adds its entry from the line scroll table.
+ */
+typedef struct {
+  unsigned short x, y;
+  unsigned char line_scroll;
+} vga_ball_scroll_t;
+
+/* Line scroll table: 512 entries, two bytes each (bits 9:8, bits 7:0) */
+#define VGA_BALL_LINE_SCROLL_SIZE 1024
+
+/* A run of bytes to copy into the name table, pattern memory, etc. */
+typedef struct {
+  unsigned short offset;
+  unsigned short length;
+  const unsigned char *data;
+} vga_ball_block_t;
+
+/*
+ * Bulk upload by DMA.  Each block's offset is a byte offset in the
+ * device: palette entries are four bytes (red, green, blue, unused).
+ * The blocks together may hold at most VGA_BALL_DMA_MAX bytes.
+ * ETIMEDOUT means the blocks may not have landed; EIO means an engine
+ * stuck by an earlier timeout has DMA off until the FPGA is reset.
+ */
+#define VGA_BALL_PALETTE_BASE     0x0400
+#define VGA_BALL_NAME_BASE        0x0800
+#define VGA_BALL_PATTERN_BASE     0x1000
+#define VGA_BALL_LINE_SCROLL_BASE 0x2000
+#define VGA_BALL_MEM_END          0x2400
+
+#define VGA_BALL_DMA_MAX          16384
+#define VGA_BALL_DMA_BLOCKS       32
+
+typedef struct {
+  unsigned int count;
+  const vga_ball_block_t *blocks;
+} vga_ball_dma_t;
+
+/*
+ * VGA_BALL_WRITE_BLOCKS takes the same list of up to
+ * VGA_BALL_DMA_BLOCKS blocks, anywhere in the register window but the
+ * DMA and interrupt registers (see VGA_BALL_HITS_CTRL), and
+ * writes them as write() would: queued for the next vertical blank
+ * when the device has an interrupt.
+ */
+
+/*
+ * Register offsets for write() and VGA_BALL_WRITE_BLOCKS, which take
+ * byte offsets in the device; multi-byte values are high byte first
+ */
+#define VGA_BALL_REG_BALL_COLOR   0   /* Circle palette index */
+#define VGA_BALL_REG_BALL_X       3   /* 12.4 fixed point, 2 bytes */
+#define VGA_BALL_REG_BALL_Y       5   /* 12.4 fixed point, 2 bytes */
+#define VGA_BALL_REG_BALL_RADIUS  7
+#define VGA_BALL_REG_BG_COLOR     8   /* Background palette index */
+#define VGA_BALL_REG_TILE_CTRL    11
+#define VGA_BALL_REG_TILE_PALETTE 12
+#define VGA_BALL_REG_SCROLL_X     21  /* 2 bytes */
+#define VGA_BALL_REG_SCROLL_Y     23  /* 2 bytes */
+#define VGA_BALL_REG_PALETTE(i)   (VGA_BALL_PALETTE_BASE + 4 * (i))
+
+/*
+ * The DMA and interrupt registers belong to the driver: write() and
+ * VGA_BALL_WRITE_BLOCKS refuse (EINVAL) any range that touches them
+ */
+#define VGA_BALL_REG_CTRL_FIRST   0x20
+#define VGA_BALL_REG_CTRL_LAST    0x25
+#define VGA_BALL_HITS_CTRL(offset, len) \
+  ((len) > 0 && (offset) <= VGA_BALL_REG_CTRL_LAST && \
+   (offset) + (len) > VGA_BALL_REG_CTRL_FIRST)
+
+#define VGA_BALL_TILE_CTRL_ENABLE      0x01
+#define VGA_BALL_TILE_CTRL_LINE_SCROLL 0x02
+
+/*
+ * Compact ABI: the ioctl argument is the value itself, so nothing is
+ * copied from userspace.  A position packs the 12.4 fixed-point x in
+ * bits 31:16 and y in bits 15:0; a color is 0xRRGGBBxx.
+ */
+#define VGA_BALL_PACK_XY(x, y) \
+  (((unsigned int)(x) << 16) | ((unsigned int)(y) & 0xFFFF))
+#define VGA_BALL_PACK_RGBX(r, g, b) \
+  (((unsigned int)(r) << 24) | ((unsigned int)(g) << 16) | \
+   ((unsigned int)(b) << 8))
+
 #define VGA_BALL_MAGIC 'q'
 
 /* ioctls and their arguments */
@@ -24,5 +151,16 @@ typedef struct {
 #define VGA_BALL_READ_BACKGROUND  _IOR(VGA_BALL_MAGIC, 2, vga_ball_arg_t)
 #define VGA_BALL_WRITE_POSITION   _IOW(VGA_BALL_MAGIC, 3, vga_ball_arg_t)
 #define VGA_BALL_READ_POSITION    _IOR(VGA_BALL_MAGIC, 4, vga_ball_arg_t)
+#define VGA_BALL_WRITE_TILES      _IOW(VGA_BALL_MAGIC, 5, vga_ball_tiles_t)
+#define VGA_BALL_WRITE_NAMES      _IOW(VGA_BALL_MAGIC, 6, vga_ball_block_t)
+#define VGA_BALL_WRITE_PATTERNS   _IOW(VGA_BALL_MAGIC, 7, vga_ball_block_t)
+#define VGA_BALL_WRITE_SCROLL     _IOW(VGA_BALL_MAGIC, 8, vga_ball_scroll_t)
+#define VGA_BALL_WRITE_LINE_SCROLL _IOW(VGA_BALL_MAGIC, 9, vga_ball_block_t)
+#define VGA_BALL_LOAD_PALETTE     _IOW(VGA_BALL_MAGIC, 10, vga_ball_palette_t)
+#define VGA_BALL_WRITE_COLOR_INDEX _IOW(VGA_BALL_MAGIC, 11, vga_ball_color_index_t)
+#define VGA_BALL_DMA_UPLOAD       _IOW(VGA_BALL_MAGIC, 12, vga_ball_dma_t)
+#define VGA_BALL_SET_POSITION     _IO(VGA_BALL_MAGIC, 13)  /* PACK_XY */
+#define VGA_BALL_SET_BACKGROUND   _IO(VGA_BALL_MAGIC, 14)  /* PACK_RGBX */
+#define VGA_BALL_WRITE_BLOCKS     _IOW(VGA_BALL_MAGIC, 15, vga_ball_dma_t)
 
 #endif